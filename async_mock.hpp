@@ -0,0 +1,317 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_ASYNCMOCK_HPP
+#define NVM_ASYNCMOCK_HPP
+#pragma once
+
+//! Completion of the asynchronous results of mocked member functions without threads.
+//! Intercepts pass std::future and other move only results through unchanged, so a mock of a member function
+//! returning std::future<T> needs only a way to make the future. The helpers below make futures which are
+//! ready at once (make_ready_future) or which complete when an executor runs (make_future_on). A
+//! manual_executor queues completions until the test runs them, one at a time or in batches, on the test's
+//! own thread. Callback based APIs post their callbacks with complete_on, and coroutines resume on the
+//! executor with co_await executor.schedule() when compiled as C++20.
+//! \code
+//! nvm::manual_executor ex;
+//! EXPECT_CALL(m, Fetch(_)).WillRepeatedly(nvm::return_future_on(ex, 42));
+//! std::future<int> f = service.Fetch(1); //! Not ready.
+//! ex.run_all();                          //! Ready.
+//! \endcode
+#include "mock.hpp"
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/enum_binary_params.hpp>
+#include <boost/preprocessor/iteration/local.hpp>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#if defined(__cpp_impl_coroutine)
+    #include <coroutine>
+#endif
+
+namespace nvm
+{
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class inline_executor
+    //! \brief Runs each task as it is posted.
+    class inline_executor
+    {
+    public:
+
+        template <typename Task>
+        void post(Task task)
+        {
+            task();
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class manual_executor
+    //! \brief Queues tasks until they are run explicitly. Tasks may be posted from any thread and may post
+    //! further tasks; they run on the thread which calls run_one, run or run_all.
+    class manual_executor : boost::noncopyable
+    {
+    public:
+
+        void post(std::function<void()> task)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+
+        //! \brief Runs the oldest task. \return false if there was none.
+        bool run_one()
+        {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                if (m_tasks.empty())
+                    return false;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+            return true;
+        }
+
+        //! \brief Runs up to n tasks, oldest first. \return the number run.
+        std::size_t run(std::size_t n)
+        {
+            std::size_t count = 0;
+            while (count < n && run_one())
+                ++count;
+            return count;
+        }
+
+        //! \brief Runs tasks until the queue is empty, including tasks posted meanwhile. \return the number run.
+        std::size_t run_all()
+        {
+            std::size_t count = 0;
+            while (run_one())
+                ++count;
+            return count;
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            return m_tasks.size();
+        }
+
+        bool empty() const { return size() == 0; }
+
+#if defined(__cpp_impl_coroutine)
+        //! Awaiting the result of schedule() resumes the coroutine when the executor runs it.
+        struct schedule_awaitable
+        {
+            manual_executor& executor;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor.post([h]() { h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+
+        schedule_awaitable schedule() { return schedule_awaitable{ *this }; }
+#endif
+
+    private:
+
+        mutable std::mutex                  m_mutex;
+        std::deque<std::function<void()>>   m_tasks;
+    };
+
+    //! \brief Returns a future which already holds value.
+    template <typename T>
+    inline std::future<typename std::decay<T>::type> make_ready_future(T&& value)
+    {
+        std::promise<typename std::decay<T>::type> p;
+        p.set_value(std::forward<T>(value));
+        return p.get_future();
+    }
+
+    inline std::future<void> make_ready_future()
+    {
+        std::promise<void> p;
+        p.set_value();
+        return p.get_future();
+    }
+
+    //! \brief Returns a future which already holds the exception e.
+    template <typename T, typename E>
+    inline std::future<T> make_exceptional_future(const E& e)
+    {
+        std::promise<T> p;
+        p.set_exception(std::make_exception_ptr(e));
+        return p.get_future();
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        struct set_promise_value
+        {
+            void operator()() const { pPromise->set_value(value); }
+
+            boost::shared_ptr< std::promise<T> >    pPromise;
+            T                                       value;
+        };
+
+        template <>
+        struct set_promise_value<void>
+        {
+            void operator()() const { pPromise->set_value(); }
+
+            boost::shared_ptr< std::promise<void> > pPromise;
+        };
+
+    }//! namespace detail;
+
+    //! \brief Returns a future which receives value when executor runs the task this posts to it.
+    //! Executor is any type with a post member taking a callable, such as manual_executor.
+    template <typename T, typename Executor>
+    inline std::future<T> make_future_on(Executor& executor, const T& value)
+    {
+        detail::set_promise_value<T> task = { boost::make_shared< std::promise<T> >(), value };
+        std::future<T> f = task.pPromise->get_future();
+        executor.post(task);
+        return f;
+    }
+
+    template <typename Executor>
+    inline std::future<void> make_future_on(Executor& executor)
+    {
+        detail::set_promise_value<void> task = { boost::make_shared< std::promise<void> >() };
+        std::future<void> f = task.pPromise->get_future();
+        executor.post(task);
+        return f;
+    }
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+    //! \brief Posts a call of callback with args to executor, for mocks of callback based member functions.
+    //! The arguments are copied.
+    template <typename Executor, typename Callback, typename... Args>
+    inline void complete_on(Executor& executor, Callback callback, Args... args)
+    {
+        executor.post(std::bind(callback, args...));
+    }
+#endif
+
+    namespace detail
+    {
+        //! A gmock action (any callable taking the mocked arguments) which returns a ready future.
+        template <typename T>
+        class return_ready_future_action
+        {
+        public:
+
+            explicit return_ready_future_action(const T& value)
+                : m_value(value)
+            {}
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+            template <typename... Args>
+            std::future<T> operator()(Args&&...) const
+            {
+                return make_ready_future(m_value);
+            }
+#else
+            std::future<T> operator()() const
+            {
+                return make_ready_future(m_value);
+            }
+
+            #define BOOST_PP_LOCAL_MACRO(n)                                         \
+            template <BOOST_PP_ENUM_PARAMS(n, typename A)>                          \
+            std::future<T> operator()(BOOST_PP_ENUM_BINARY_PARAMS(n, const A, &)) const\
+            {                                                                       \
+                return make_ready_future(m_value);                                  \
+            }                                                                       \
+            /***/
+
+            #define BOOST_PP_LOCAL_LIMITS (1, NVM_MAX_MOCK_PARAMS)
+            #include BOOST_PP_LOCAL_ITERATE()
+#endif
+
+        private:
+
+            T m_value;
+        };
+
+        //! A gmock action which returns a future completed by an executor.
+        template <typename T, typename Executor>
+        class return_future_on_action
+        {
+        public:
+
+            return_future_on_action(Executor& executor, const T& value)
+                : m_pExecutor(&executor)
+                , m_value(value)
+            {}
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+            template <typename... Args>
+            std::future<T> operator()(Args&&...) const
+            {
+                return make_future_on(*m_pExecutor, m_value);
+            }
+#else
+            std::future<T> operator()() const
+            {
+                return make_future_on(*m_pExecutor, m_value);
+            }
+
+            #define BOOST_PP_LOCAL_MACRO(n)                                         \
+            template <BOOST_PP_ENUM_PARAMS(n, typename A)>                          \
+            std::future<T> operator()(BOOST_PP_ENUM_BINARY_PARAMS(n, const A, &)) const\
+            {                                                                       \
+                return make_future_on(*m_pExecutor, m_value);                       \
+            }                                                                       \
+            /***/
+
+            #define BOOST_PP_LOCAL_LIMITS (1, NVM_MAX_MOCK_PARAMS)
+            #include BOOST_PP_LOCAL_ITERATE()
+#endif
+
+        private:
+
+            Executor*   m_pExecutor;
+            T           m_value;
+        };
+
+    }//! namespace detail;
+
+    //! \brief An action for a mocked function returning std::future<T>: each call returns a future which
+    //! already holds value.
+    template <typename T>
+    inline detail::return_ready_future_action<T> return_ready_future(const T& value)
+    {
+        return detail::return_ready_future_action<T>(value);
+    }
+
+    //! \brief An action for a mocked function returning std::future<T>: each call returns a future which
+    //! receives value when executor runs the completion posted by the call. Completions queued on a
+    //! manual_executor can be released in any batch size with run and run_all.
+    template <typename T, typename Executor>
+    inline detail::return_future_on_action<T, Executor> return_future_on(Executor& executor, const T& value)
+    {
+        return detail::return_future_on_action<T, Executor>(executor, value);
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_ASYNCMOCK_HPP
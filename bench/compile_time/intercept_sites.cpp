@@ -0,0 +1,103 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+//! Compile time benchmark TU. This file contains NVM_BENCH_CLASSES * NVM_BENCH_METHODS intercept sites,
+//! each with a matching mock member function and registration, with arities cycling from 1 to 8.
+//! It is compiled by bench/compile_time/run.sh at increasing sizes to measure per-TU build time.
+//! With NVM_BENCH_PRODUCTION_ONLY defined it contains only the intercepting classes and includes only
+//! intercept.hpp, as a production TU would.
+//
+#if defined(NVM_BENCH_PRODUCTION_ONLY)
+    #include <nvmock/intercept.hpp>
+#else
+    #include <nvmock/mock.hpp>
+#endif
+
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/enum_binary_params.hpp>
+#include <boost/preprocessor/arithmetic/mod.hpp>
+#include <boost/preprocessor/arithmetic/inc.hpp>
+#include <boost/preprocessor/facilities/intercept.hpp>
+
+#if !defined(NVM_BENCH_CLASSES)
+    #define NVM_BENCH_CLASSES 16
+#endif
+
+#if !defined(NVM_BENCH_METHODS)
+    #define NVM_BENCH_METHODS 8
+#endif
+
+#define NVM_BENCH_ARITY(m) BOOST_PP_INC(BOOST_PP_MOD(m, 8))
+
+#define NVM_BENCH_METHOD(z, m, c)                                                                       \
+    int BOOST_PP_CAT(Method, m)(BOOST_PP_ENUM_BINARY_PARAMS_Z(z, NVM_BENCH_ARITY(m), int a, BOOST_PP_INTERCEPT))\
+    {                                                                                                   \
+        NVM_MOCK_INTERCEPT(BOOST_PP_CAT(Sited, c)::BOOST_PP_CAT(Method, m)                              \
+                         , BOOST_PP_ENUM_PARAMS_Z(z, NVM_BENCH_ARITY(m), a));                           \
+        return m;                                                                                       \
+    }                                                                                                   \
+/***/
+
+#define NVM_BENCH_MOCK_METHOD(z, m, c)                                                                  \
+    int BOOST_PP_CAT(Method, m)(BOOST_PP_ENUM_BINARY_PARAMS_Z(z, NVM_BENCH_ARITY(m), int a, BOOST_PP_INTERCEPT))\
+    {                                                                                                   \
+        return -m;                                                                                      \
+    }                                                                                                   \
+/***/
+
+#define NVM_BENCH_REGISTER(z, m, c)                                                                     \
+    NVM_REGISTER_MOCK_MEMBER_FUNCTION(BOOST_PP_CAT(Sited, c), BOOST_PP_CAT(MockSited, c), BOOST_PP_CAT(Method, m));\
+/***/
+
+#define NVM_BENCH_SITED_CLASS(z, c, _)                                                                  \
+    struct BOOST_PP_CAT(Sited, c) : virtual nvm::mockable                                               \
+    {                                                                                                   \
+        BOOST_PP_REPEAT_ ## z(NVM_BENCH_METHODS, NVM_BENCH_METHOD, c)                                   \
+    };                                                                                                  \
+/***/
+
+#define NVM_BENCH_CLASS(z, c, _)                                                                        \
+    NVM_BENCH_SITED_CLASS(z, c, _)                                                                      \
+    struct BOOST_PP_CAT(MockSited, c) : nvm::mock< BOOST_PP_CAT(Sited, c) >                             \
+    {                                                                                                   \
+        BOOST_PP_CAT(MockSited, c)()                                                                    \
+        {                                                                                               \
+            NVM_ONCE_BLOCK()                                                                            \
+            {                                                                                           \
+                BOOST_PP_REPEAT_ ## z(NVM_BENCH_METHODS, NVM_BENCH_REGISTER, c)                         \
+            }                                                                                           \
+        }                                                                                               \
+        BOOST_PP_REPEAT_ ## z(NVM_BENCH_METHODS, NVM_BENCH_MOCK_METHOD, c)                              \
+    };                                                                                                  \
+/***/
+
+#if defined(NVM_BENCH_PRODUCTION_ONLY)
+namespace
+{
+    BOOST_PP_REPEAT(NVM_BENCH_CLASSES, NVM_BENCH_SITED_CLASS, _)
+}//! anonymous
+
+int main()
+{
+    Sited0 s;
+    return s.Method0(1) == 0 ? 0 : 1;
+}
+#else
+namespace
+{
+    BOOST_PP_REPEAT(NVM_BENCH_CLASSES, NVM_BENCH_CLASS, _)
+}//! anonymous
+
+int main()
+{
+    MockSited0 m;
+    Sited0& s = m;
+    return s.Method0(1) == 0 ? 0 : 1;
+}
+#endif
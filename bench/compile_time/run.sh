@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Copyright © 2015
+# Brandon Kohn
+#
+#  Distributed under the Boost Software License, Version 1.0. (See
+#  accompanying file LICENSE_1_0.txt or copy at
+#  http://www.boost.org/LICENSE_1_0.txt)
+#
+# Measures the build time of one TU as the number of intercept sites grows, for both the
+# variadic and the preprocessed implementations, and for a production TU which has only the
+# intercept sites (intercept.hpp) and no mocks.
+#
+# Usage: bench/compile_time/run.sh [include dir containing nvmock/]
+# Environment: CXX (default g++), CXXFLAGS (default -std=c++11 -O2), CLASSES (list of class counts).
+#
+HERE=$(cd "$(dirname "$0")" && pwd)
+INCLUDE=${1:-$(cd "$HERE/../../.." && pwd)}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--std=c++11 -O2}
+CLASSES=${CLASSES:-1 4 16 32 64}
+METHODS=8
+
+printf "%-8s %-14s %s\n" sites mode seconds
+for classes in $CLASSES; do
+    for mode in variadic preprocessed production; do
+        defs="-DNVM_BENCH_CLASSES=$classes -DNVM_BENCH_METHODS=$METHODS"
+        [ "$mode" = preprocessed ] && defs="$defs -DNVM_NO_VARIADIC_TEMPLATES"
+        [ "$mode" = production ] && defs="$defs -DNVM_BENCH_PRODUCTION_ONLY"
+        start=$(date +%s.%N)
+        $CXX $CXXFLAGS -I"$INCLUDE" $defs -c "$HERE/intercept_sites.cpp" -o /dev/null || exit 1
+        end=$(date +%s.%N)
+        printf "%-8s %-14s %s\n" $((classes * METHODS)) $mode $(awk "BEGIN { printf \"%.2f\", $end - $start }")
+    done
+done
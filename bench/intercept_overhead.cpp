@@ -0,0 +1,336 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <nvmock/mock.hpp>
+
+#include <benchmark/benchmark.h>
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/punctuation/comma_if.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/enum_binary_params.hpp>
+#include <boost/preprocessor/facilities/intercept.hpp>
+#include <boost/preprocessor/arithmetic/inc.hpp>
+
+//! Measures the cost of one call through an intercepted member function:
+//! - a plain member function without an intercept (the baseline),
+//! - unmocked nvm::mockable and NVM_IMPLEMENT_MOCKABLE types with no mock alive in the process,
+//! - the same unmocked calls while some unrelated mock is alive (the intercept gate is open),
+//! - mocked calls at arities 0 through 10,
+//! - overloaded and const overloaded intercepts, mocked and unmocked,
+//! - a static_mockable class template, unmocked and bound to a static mock (variadic path only),
+//! - a free function with NVM_FUNCTION_INTERCEPT, unmocked, with the gate open and under a function_mock.
+//! Every call goes through a BOOST_NOINLINE forwarding function so that the intercept cannot be
+//! optimized away at the call site and each variant pays the same call overhead as the baseline.
+namespace
+{
+    //! boost::bind binds at most eight arguments to a member function, which caps the preprocessed path.
+    #if defined(NVM_HAS_VARIADIC_TEMPLATES)
+        #define NVM_BENCH_MAX_ARITY 10
+    #else
+        #define NVM_BENCH_MAX_ARITY 8
+    #endif
+
+    //////////////////////////////////////////////////////////////////////////
+    //! Single method types.
+    struct Plain
+    {
+        int Get(int a)
+        {
+            return a + 1;
+        }
+    };
+
+    struct DerivesMockable : virtual nvm::mockable
+    {
+        int Get(int a)
+        {
+            NVM_MOCK_INTERCEPT(DerivesMockable::Get, a);
+            return a + 1;
+        }
+    };
+
+    struct UsesImplementMockable
+    {
+        NVM_IMPLEMENT_MOCKABLE();
+
+        int Get(int a)
+        {
+            NVM_MOCK_INTERCEPT(UsesImplementMockable::Get, a);
+            return a + 1;
+        }
+    };
+
+    struct MockDerivesMockable : nvm::mock<DerivesMockable>
+    {
+        MockDerivesMockable()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(DerivesMockable, MockDerivesMockable, Get);
+            }
+        }
+
+        int Get(int a) { return a - 1; }
+    };
+
+    struct MockUsesImplementMockable : nvm::mock<UsesImplementMockable>
+    {
+        MockUsesImplementMockable()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(UsesImplementMockable, MockUsesImplementMockable, Get);
+            }
+        }
+
+        int Get(int a) { return a - 1; }
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    //! Arities 0..NVM_BENCH_MAX_ARITY. Call0 is written out as the generated methods always take arguments.
+    #define NVM_BENCH_ARITY_METHOD(z, n, _)                                                            \
+        int BOOST_PP_CAT(Call, n)(BOOST_PP_ENUM_BINARY_PARAMS_Z(z, n, int a, BOOST_PP_INTERCEPT))      \
+        {                                                                                              \
+            NVM_MOCK_INTERCEPT(Arities::BOOST_PP_CAT(Call, n), BOOST_PP_ENUM_PARAMS_Z(z, n, a));       \
+            return n;                                                                                  \
+        }                                                                                              \
+    /***/
+
+    #define NVM_BENCH_ARITY_MOCK_METHOD(z, n, _)                                                       \
+        int BOOST_PP_CAT(Call, n)(BOOST_PP_ENUM_PARAMS_Z(z, n, int BOOST_PP_INTERCEPT))                \
+        {                                                                                              \
+            return -n;                                                                                 \
+        }                                                                                              \
+    /***/
+
+    #define NVM_BENCH_ARITY_REGISTER(z, n, _)                                                          \
+        NVM_REGISTER_MOCK_MEMBER_FUNCTION(Arities, MockArities, BOOST_PP_CAT(Call, n));                \
+    /***/
+
+    struct Arities : virtual nvm::mockable
+    {
+        int Call0()
+        {
+            NVM_MOCK_INTERCEPT(Arities::Call0);
+            return 0;
+        }
+
+        BOOST_PP_REPEAT_FROM_TO(1, BOOST_PP_INC(NVM_BENCH_MAX_ARITY), NVM_BENCH_ARITY_METHOD, _)
+    };
+
+    struct MockArities : nvm::mock<Arities>
+    {
+        MockArities()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                BOOST_PP_REPEAT(BOOST_PP_INC(NVM_BENCH_MAX_ARITY), NVM_BENCH_ARITY_REGISTER, _)
+            }
+        }
+
+        BOOST_PP_REPEAT(BOOST_PP_INC(NVM_BENCH_MAX_ARITY), NVM_BENCH_ARITY_MOCK_METHOD, _)
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    //! Overloads.
+    struct Overloads : virtual nvm::mockable
+    {
+        int Get(int a)
+        {
+            NVM_MOCK_OVERLOAD_INTERCEPT(Overloads, Get, int(int), a);
+            return a + 1;
+        }
+
+        int Get(int a, int b) const
+        {
+            NVM_MOCK_OVERLOAD_CONST_INTERCEPT(Overloads, Get, int(int, int), a, b);
+            return a + b;
+        }
+    };
+
+    struct MockOverloads : nvm::mock<Overloads>
+    {
+        MockOverloads()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_OVERLOADED_MEMBER_FUNCTION(Overloads, MockOverloads, Get, int(int));
+                NVM_REGISTER_MOCK_OVERLOADED_CONST_MEMBER_FUNCTION(Overloads, MockOverloads, Get, int(int, int));
+            }
+        }
+
+        int Get(int a) { return a - 1; }
+        int Get(int a, int b) const { return a - b; }
+    };
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+    //////////////////////////////////////////////////////////////////////////
+    //! Compile time mock binding.
+    template <typename Mock = void>
+    struct StaticMockableT : nvm::static_mockable<Mock>
+    {
+        int Get(int a)
+        {
+            NVM_MOCK_INTERCEPT(StaticMockableT::Get, a);
+            return a + 1;
+        }
+    };
+    typedef StaticMockableT<> StaticMockable;
+
+    struct StaticMock : StaticMockableT<StaticMock>
+    {
+        int Get(int a) { return a - 1; }
+
+        NVM_STATIC_MOCK_MEMBER_FUNCTION(StaticMockableT<StaticMock>, Get);
+    };
+#endif
+
+    //////////////////////////////////////////////////////////////////////////
+    //! Free functions.
+    BOOST_NOINLINE int PlainFunction(int a)
+    {
+        return a + 1;
+    }
+
+    BOOST_NOINLINE int InterceptedFunction(int a)
+    {
+        NVM_FUNCTION_INTERCEPT(InterceptedFunction, a);
+        return a + 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    //! Out of line call wrappers.
+    template <typename T>
+    BOOST_NOINLINE int CallGet(T& t, int a)
+    {
+        return t.Get(a);
+    }
+
+    BOOST_NOINLINE int CallConstGet(const Overloads& t, int a)
+    {
+        return t.Get(a, a);
+    }
+
+    #define NVM_BENCH_ARITY_CALLER(z, n, _)                                                            \
+        BOOST_NOINLINE int BOOST_PP_CAT(CallArity, n)(Arities& t, int a)                               \
+        {                                                                                              \
+            (void)a;                                                                                   \
+            return t.BOOST_PP_CAT(Call, n)(BOOST_PP_ENUM_PARAMS_Z(z, n, a BOOST_PP_INTERCEPT));        \
+        }                                                                                              \
+    /***/
+    BOOST_PP_REPEAT(BOOST_PP_INC(NVM_BENCH_MAX_ARITY), NVM_BENCH_ARITY_CALLER, _)
+
+    //////////////////////////////////////////////////////////////////////////
+    //! Benchmarks.
+    template <typename T>
+    void BM_Get(benchmark::State& state)
+    {
+        T t;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallGet(t, ++i));
+    }
+
+    //! Unmocked calls while an unrelated mock keeps the intercept gate open.
+    template <typename T>
+    void BM_GetWithLiveMock(benchmark::State& state)
+    {
+        MockArities live;
+        T t;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallGet(t, ++i));
+    }
+
+    //! Mocked calls through a reference to the original type.
+    template <typename Mock, typename T>
+    void BM_MockedGet(benchmark::State& state)
+    {
+        Mock m;
+        T& t = m;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallGet(t, ++i));
+    }
+
+    template <typename T>
+    void BM_ConstOverloadGet(benchmark::State& state)
+    {
+        T t;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallConstGet(t, ++i));
+    }
+
+    //! Mocked calls at each arity; the caller for arity n is chosen outside of the timed loop.
+    typedef int (*arity_caller)(Arities&, int);
+    #define NVM_BENCH_ARITY_CALLER_NAME(z, n, _) BOOST_PP_COMMA_IF(n) BOOST_PP_CAT(CallArity, n) /***/
+    const arity_caller g_arityCallers[] = { BOOST_PP_REPEAT(BOOST_PP_INC(NVM_BENCH_MAX_ARITY), NVM_BENCH_ARITY_CALLER_NAME, _) };
+
+    void BM_MockedArity(benchmark::State& state)
+    {
+        arity_caller call = g_arityCallers[state.range(0)];
+        MockArities m;
+        Arities& t = m;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(call(t, ++i));
+    }
+
+    typedef int (*function_type)(int);
+
+    void BM_Function(benchmark::State& state)
+    {
+        function_type call = state.range(0) ? InterceptedFunction : PlainFunction;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(call(++i));
+    }
+
+    void BM_FunctionWithLiveMock(benchmark::State& state)
+    {
+        MockArities live;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(InterceptedFunction(++i));
+    }
+
+    void BM_MockedFunction(benchmark::State& state)
+    {
+        NVM_FUNCTION_MOCK(mocked, InterceptedFunction, [](int a) { return a - 1; });
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(InterceptedFunction(++i));
+    }
+
+    BENCHMARK_TEMPLATE(BM_Get, Plain);
+    BENCHMARK_TEMPLATE(BM_Get, DerivesMockable);
+    BENCHMARK_TEMPLATE(BM_Get, UsesImplementMockable);
+    BENCHMARK_TEMPLATE(BM_GetWithLiveMock, Plain);
+    BENCHMARK_TEMPLATE(BM_GetWithLiveMock, DerivesMockable);
+    BENCHMARK_TEMPLATE(BM_GetWithLiveMock, UsesImplementMockable);
+    BENCHMARK_TEMPLATE(BM_MockedGet, MockDerivesMockable, DerivesMockable);
+    BENCHMARK_TEMPLATE(BM_MockedGet, MockUsesImplementMockable, UsesImplementMockable);
+    BENCHMARK_TEMPLATE(BM_Get, Overloads);
+    BENCHMARK_TEMPLATE(BM_ConstOverloadGet, Overloads);
+    BENCHMARK_TEMPLATE(BM_MockedGet, MockOverloads, Overloads);
+    BENCHMARK_TEMPLATE(BM_ConstOverloadGet, MockOverloads);
+    BENCHMARK(BM_MockedArity)->DenseRange(0, NVM_BENCH_MAX_ARITY);
+    BENCHMARK(BM_Function)->Arg(0)->Arg(1);
+    BENCHMARK(BM_FunctionWithLiveMock);
+    BENCHMARK(BM_MockedFunction);
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+    BENCHMARK_TEMPLATE(BM_Get, StaticMockable);
+    BENCHMARK_TEMPLATE(BM_MockedGet, StaticMock, StaticMockableT<StaticMock>);
+#endif
+
+}//! anonymous
+
+BENCHMARK_MAIN();
@@ -0,0 +1,228 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <nvmock/mock.hpp>
+#include <nvmock/mock_pool.hpp>
+
+#include <benchmark/benchmark.h>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+//! Measures mocked dispatch throughput as the number of calling threads grows from 1 to the number
+//! of hardware threads. Reading the registry must not serialize callers, so items/s should scale
+//! close to linearly with the thread count, including while another thread keeps registering sites.
+namespace
+{
+    struct Dispatched : virtual nvm::mockable
+    {
+        int Value(int a)
+        {
+            NVM_MOCK_INTERCEPT(Dispatched::Value, a);
+            return -a;
+        }
+    };
+
+    //! A hand written mock keeps the measurement on the dispatch path rather than in a mocking framework.
+    struct MockDispatched : nvm::mock<Dispatched>
+    {
+        MockDispatched()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Dispatched, MockDispatched, Value);
+            }
+        }
+
+        int Value(int a) { return a; }
+    };
+
+    //! The same mock registered through a mock table: its constructor does nothing.
+    struct TabledDispatched : nvm::mock<Dispatched>
+    {
+        int Value(int a) { return a; }
+    };
+
+    NVM_BEGIN_MOCK_TABLE(TabledDispatched)
+        NVM_MOCK_TABLE_MEMBER_FUNCTION(Dispatched, Value)
+    NVM_END_MOCK_TABLE()
+
+    int CallValue(Dispatched& d, int a)
+    {
+        return d.Value(a);
+    }
+
+    //! Each thread dispatches through its own mock instance.
+    void BM_MockedDispatchPerThreadMock(benchmark::State& state)
+    {
+        MockDispatched m;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallValue(m, ++i));
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    //! All threads dispatch through one shared mock instance.
+    MockDispatched* g_pShared = 0;
+    void BM_MockedDispatchSharedMock(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+            g_pShared = new MockDispatched;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallValue(*g_pShared, ++i));
+        state.SetItemsProcessed(state.iterations());
+        if (state.thread_index() == 0)
+        {
+            delete g_pShared;
+            g_pShared = 0;
+        }
+    }
+
+    //! A background writer keeps adding sites to the registry while the benchmark threads dispatch.
+    std::atomic<bool> g_stopWriter(false);
+    std::thread       g_writer;
+    void BM_MockedDispatchWithConcurrentRegistration(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+        {
+            g_stopWriter = false;
+            g_writer = std::thread([]()
+            {
+                static int s_key = 0;
+                for (int n = 0; !g_stopWriter && n < 4096; ++n)
+                    nvm::get_mock_site(&Dispatched::Value, "scaling::" + boost::lexical_cast<std::string>(s_key++));
+            });
+        }
+
+        MockDispatched m;
+        int i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(CallValue(m, ++i));
+        state.SetItemsProcessed(state.iterations());
+
+        if (state.thread_index() == 0)
+        {
+            g_stopWriter = true;
+            g_writer.join();
+        }
+    }
+
+    //! Constructing short lived mocks: each construction of MockDispatched enters its once block.
+    void BM_ConstructOnceBlockMock(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            MockDispatched m;
+            benchmark::DoNotOptimize(&m);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_ConstructMockTableMock(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            TabledDispatched m;
+            benchmark::DoNotOptimize(&m);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    //! A batch of mocks allocated one at a time and destroyed after each iteration.
+    void BM_ConstructBatchNew(benchmark::State& state)
+    {
+        std::vector<TabledDispatched*> mocks(state.range(0));
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < mocks.size(); ++i)
+                mocks[i] = new TabledDispatched;
+            for (std::size_t i = 0; i < mocks.size(); ++i)
+                delete mocks[i];
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    //! The same batch from a mock_pool which is cleared and reused after each iteration.
+    void BM_ConstructBatchPool(benchmark::State& state)
+    {
+        nvm::mock_pool<TabledDispatched> pool;
+        std::vector<TabledDispatched*> mocks;
+        for (auto _ : state)
+        {
+            mocks.clear();
+            pool.create_n(state.range(0), mocks);
+            pool.clear();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    //! Stands in for the mockers of a large suite: one per site.
+    struct NullMocker : nvm::mocker
+    {
+        boost::shared_ptr<nvm::mock_function_base> operator()(void*) const { return boost::shared_ptr<nvm::mock_function_base>(); }
+    };
+
+    std::vector<nvm::mock_site*> MakeSites(std::size_t n)
+    {
+        std::vector<nvm::mock_site*> sites;
+        for (std::size_t i = 0; i < n; ++i)
+            sites.push_back(&nvm::get_mock_site(&Dispatched::Value, "setup::" + boost::lexical_cast<std::string>(i)));
+        return sites;
+    }
+
+    //! Test setup which registers every mocker in a fresh context.
+    void BM_ContextSetupRegister(benchmark::State& state)
+    {
+        std::vector<nvm::mock_site*> sites = MakeSites(state.range(0));
+        boost::shared_ptr<nvm::mocker> pMocker = boost::make_shared<NullMocker>();
+        for (auto _ : state)
+        {
+            nvm::mock_context c;
+            for (std::size_t i = 0; i < sites.size(); ++i)
+                c.set_mocker(*sites[i], pMocker);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    //! Test setup which starts a fresh context from a snapshot of the same registrations.
+    void BM_ContextSetupFromSnapshot(benchmark::State& state)
+    {
+        std::vector<nvm::mock_site*> sites = MakeSites(state.range(0));
+        boost::shared_ptr<nvm::mocker> pMocker = boost::make_shared<NullMocker>();
+        nvm::mock_context baseline;
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            baseline.set_mocker(*sites[i], pMocker);
+        nvm::mock_context::snapshot s = baseline.get_snapshot();
+        for (auto _ : state)
+        {
+            nvm::mock_context c(s);
+            benchmark::DoNotOptimize(&c);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    benchmark::RegisterBenchmark("MockedDispatch/PerThreadMock", BM_MockedDispatchPerThreadMock)->ThreadRange(1, maxThreads)->UseRealTime();
+    benchmark::RegisterBenchmark("MockedDispatch/SharedMock", BM_MockedDispatchSharedMock)->ThreadRange(1, maxThreads)->UseRealTime();
+    benchmark::RegisterBenchmark("MockedDispatch/ConcurrentRegistration", BM_MockedDispatchWithConcurrentRegistration)->ThreadRange(1, maxThreads)->UseRealTime();
+    benchmark::RegisterBenchmark("Construct/OnceBlockMock", BM_ConstructOnceBlockMock)->ThreadRange(1, maxThreads)->UseRealTime();
+    benchmark::RegisterBenchmark("Construct/MockTableMock", BM_ConstructMockTableMock)->ThreadRange(1, maxThreads)->UseRealTime();
+    benchmark::RegisterBenchmark("ConstructBatch/New", BM_ConstructBatchNew)->Arg(100000);
+    benchmark::RegisterBenchmark("ConstructBatch/Pool", BM_ConstructBatchPool)->Arg(100000);
+    benchmark::RegisterBenchmark("ContextSetup/Register", BM_ContextSetupRegister)->Arg(100)->Arg(1000);
+    benchmark::RegisterBenchmark("ContextSetup/FromSnapshot", BM_ContextSetupFromSnapshot)->Arg(100)->Arg(1000);
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
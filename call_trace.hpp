@@ -0,0 +1,97 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_CALLTRACE_HPP
+#define NVM_CALLTRACE_HPP
+#pragma once
+
+//! Recording of intercepted calls.
+//! Intercept sites compiled with NVM_ENABLE_CALL_TRACE defined push a call_record to a per thread ring buffer
+//! on every call while enable_call_trace(true) is in effect. Sites compiled without it carry no tracing code.
+//! Records are collected with drain_call_trace and can be written as Chrome trace event JSON, which both
+//! chrome://tracing and the Perfetto UI load.
+#include "detail/call_trace_buffer.hpp"
+#include "detail/mock_site.hpp"
+
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace nvm
+{
+    //! \brief Starts or stops recording at intercept sites compiled with NVM_ENABLE_CALL_TRACE.
+    inline void enable_call_trace(bool enable = true)
+    {
+        detail::call_trace_flag().store(enable, std::memory_order_relaxed);
+    }
+
+    //! \brief Appends the calls recorded by every thread since the last drain to records.
+    //! Records are in order per thread; records from different threads are not merged.
+    //! \return the number of records lost because a thread's ring buffer wrapped before they were drained.
+    inline std::size_t drain_call_trace(std::vector<call_record>& records)
+    {
+        return detail::call_trace_registry::instance().drain(records);
+    }
+
+    namespace detail
+    {
+        inline void write_json_string(std::ostream& os, const std::string& s)
+        {
+            os << '"';
+            for (std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+            {
+                if (*it == '"' || *it == '\\')
+                    os << '\\' << *it;
+                else if (static_cast<unsigned char>(*it) < 0x20)
+                    os << ' ';
+                else
+                    os << *it;
+            }
+            os << '"';
+        }
+    }//! namespace detail;
+
+    //! \brief Writes records as Chrome trace event format JSON.
+    //! Each call is a thread scoped instant event named after the member function. The site id, object
+    //! address, argument count and mask and the copied argument bytes (hex) are attached as event args.
+    inline void write_chrome_trace(std::ostream& os, const std::vector<call_record>& records)
+    {
+        std::vector<std::string> names;
+        os << "{\"traceEvents\":[";
+        for (std::size_t i = 0; i < records.size(); ++i)
+        {
+            const call_record& r = records[i];
+            if (names.size() <= r.siteId)
+                names.resize(r.siteId + 1);
+            if (names[r.siteId].empty())
+            {
+                const mock_site* pSite = detail::site_registry::instance().get_site_by_id(r.siteId);
+                names[r.siteId] = pSite ? pSite->name() : "site " + std::to_string(r.siteId);
+            }
+
+            char buffer[64];
+            os << (i ? ",\n" : "\n") << "{\"name\":";
+            detail::write_json_string(os, names[r.siteId]);
+            std::snprintf(buffer, sizeof(buffer), "%.3f", r.timestamp / 1000.0);
+            os << ",\"cat\":\"nvm\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << r.threadIndex << ",\"ts\":" << buffer;
+            std::snprintf(buffer, sizeof(buffer), "%p", r.pObject);
+            os << ",\"args\":{\"site\":" << r.siteId << ",\"object\":\"" << buffer << "\",\"argc\":" << r.argCount << ",\"argmask\":" << r.argMask << ",\"bytes\":\"";
+            for (std::size_t b = 0; b < r.argBytes; ++b)
+            {
+                std::snprintf(buffer, sizeof(buffer), "%02x", r.args[b]);
+                os << buffer;
+            }
+            os << "\"}}";
+        }
+        os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_CALLTRACE_HPP
@@ -0,0 +1,559 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_CAPTURE_HPP
+#define NVM_CAPTURE_HPP
+#pragma once
+
+//! Record and replay of calls through intercept sites.
+//! A capture_mock constructed with a capture_writer passes calls to the real implementation and appends the
+//! arguments and result of each call to a capture file. Constructed with a capture_reader over that file it
+//! returns the recorded results, in order per member function, without calling the real implementation.
+//!
+//! Capture file layout: the 8 byte magic "NVMCAP01" followed by records. Each record is a
+//! detail::capture_record_header followed by the argument bytes and the result bytes, each padded to 8 bytes
+//! so that every header is aligned in the mapped file. Arguments and results are encoded by capture_traits.
+//! Member functions are identified by a hash of their registry key, which is stable between runs of the
+//! same build.
+#include "mock.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/make_shared.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+    #error "NVM capture requires variadic templates."
+#endif
+
+namespace nvm
+{
+    //! \struct capture_traits
+    //! \brief Encodes argument and result values in a capture file.
+    //! Trivially copyable types are stored as their bytes. Specialize for other types. On replay an argument matches
+    //! a recorded one with the same bytes, or, for a trivially copyable type with an operator==, an equal value, so
+    //! that padding bytes do not cause spurious mismatches.
+    template <typename T, typename Enable = void>
+    struct capture_traits
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Specialize nvm::capture_traits to capture types which are not trivially copyable.");
+
+        static void write(std::vector<char>& out, const T& v)
+        {
+            const char* p = reinterpret_cast<const char*>(&v);
+            out.insert(out.end(), p, p + sizeof(T));
+        }
+
+        static T read(const char*& p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+    };
+
+    template <>
+    struct capture_traits<std::string>
+    {
+        static void write(std::vector<char>& out, const std::string& v)
+        {
+            capture_traits<std::uint64_t>::write(out, v.size());
+            out.insert(out.end(), v.begin(), v.end());
+        }
+
+        static std::string read(const char*& p)
+        {
+            std::size_t size = static_cast<std::size_t>(capture_traits<std::uint64_t>::read(p));
+            std::string v(p, size);
+            p += size;
+            return v;
+        }
+    };
+
+    namespace detail
+    {
+        struct capture_record_header
+        {
+            std::uint64_t site;
+            std::uint32_t argBytes;
+            std::uint32_t resultBytes;
+        };
+
+        static const char capture_magic[8] = { 'N', 'V', 'M', 'C', 'A', 'P', '0', '1' };
+
+        inline std::size_t capture_padded(std::size_t n)
+        {
+            return (n + 7) & ~std::size_t(7);
+        }
+
+        //! FNV-1a.
+        inline std::uint64_t capture_site_hash(const std::string& key)
+        {
+            std::uint64_t h = 14695981039346656037ULL;
+            for (std::string::const_iterator it = key.begin(); it != key.end(); ++it)
+            {
+                h ^= static_cast<unsigned char>(*it);
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
+        template <typename... Args>
+        inline void write_capture_args(std::vector<char>& out, const Args&... args)
+        {
+            int expand[] = { 0, (capture_traits<typename std::decay<Args>::type>::write(out, args), 0)... };
+            (void)expand;
+        }
+
+        template <typename T, typename Enable = void>
+        struct is_capture_comparable : std::false_type {};
+
+        template <typename T>
+        struct is_capture_comparable<T, typename std::enable_if<std::is_convertible<decltype(std::declval<const T&>() == std::declval<const T&>()), bool>::value>::type>
+            : std::is_trivially_copyable<T>
+        {};
+
+        //! Bytes which differ may only be padding, so trivially copyable values with an operator== are decoded and compared.
+        template <typename T>
+        inline bool capture_arg_equal(const char* pRecorded, const T& v, std::true_type)
+        {
+            return capture_traits<T>::read(pRecorded) == v;
+        }
+
+        template <typename T>
+        inline bool capture_arg_equal(const char*, const T&, std::false_type)
+        {
+            return false;
+        }
+
+        //! Compares the recorded arguments at pArgs (argBytes long) with args, one argument at a time.
+        //! \param buffer is scratch space for the encoding of one argument.
+        inline bool capture_args_match(std::vector<char>&, const char*, std::size_t argBytes)
+        {
+            return argBytes == 0;
+        }
+
+        template <typename Arg, typename... Args>
+        inline bool capture_args_match(std::vector<char>& buffer, const char* pArgs, std::size_t argBytes, const Arg& arg, const Args&... args)
+        {
+            typedef typename std::decay<Arg>::type value_type;
+            buffer.clear();
+            capture_traits<value_type>::write(buffer, arg);
+            if (buffer.size() > argBytes)
+                return false;
+            if ((!buffer.empty() && std::memcmp(&buffer[0], pArgs, buffer.size()) != 0) && !capture_arg_equal<value_type>(pArgs, arg, is_capture_comparable<value_type>()))
+                return false;
+            std::size_t size = buffer.size();
+            return capture_args_match(buffer, pArgs + size, argBytes - size, args...);
+        }
+
+        template <typename R>
+        struct capture_result
+        {
+            static_assert(!std::is_reference<R>::value, "Member functions returning references cannot be captured.");
+
+            static R read(const char* p) { return capture_traits<typename std::remove_cv<R>::type>::read(p); }
+
+            template <typename Writer, typename Fn>
+            static R record(Writer& w, std::uint64_t site, const std::vector<char>& args, Fn fn)
+            {
+                R r = fn();
+                std::vector<char> result;
+                capture_traits<typename std::remove_cv<R>::type>::write(result, r);
+                w.append(site, args, result);
+                return r;
+            }
+        };
+
+        template <>
+        struct capture_result<void>
+        {
+            static void read(const char*) {}
+
+            template <typename Writer, typename Fn>
+            static void record(Writer& w, std::uint64_t site, const std::vector<char>& args, Fn fn)
+            {
+                fn();
+                w.append(site, args, std::vector<char>());
+            }
+        };
+
+    }//! namespace detail;
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class capture_writer
+    //! \brief Appends call records to a capture file.
+    //! Callers serialize into an in memory batch; a background thread writes batches to the file once they
+    //! reach batchBytes or every few milliseconds, so recording does not wait on the disk.
+    class capture_writer : boost::noncopyable
+    {
+    public:
+
+        explicit capture_writer(const std::string& path, std::size_t batchBytes = 1 << 20)
+            : m_file(path.c_str(), std::ios::binary | std::ios::trunc)
+            , m_batchBytes(batchBytes)
+            , m_appended(0)
+            , m_written(0)
+            , m_flushWaiters(0)
+            , m_failed(false)
+            , m_stop(false)
+        {
+            if (!m_file.write(detail::capture_magic, sizeof(detail::capture_magic)))
+                BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_writer: cannot open " + path));
+            m_thread = std::thread(&capture_writer::run, this);
+        }
+
+        ~capture_writer()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            m_thread.join();
+        }
+
+        void append(std::uint64_t site, const std::vector<char>& args, const std::vector<char>& result)
+        {
+            detail::capture_record_header header = { site, static_cast<std::uint32_t>(args.size()), static_cast<std::uint32_t>(result.size()) };
+            std::size_t argSize = detail::capture_padded(args.size());
+            std::size_t size = sizeof(header) + argSize + detail::capture_padded(result.size());
+
+            std::unique_lock<std::mutex> lk(m_mutex);
+            std::size_t offset = m_pending.size();
+            m_pending.resize(offset + size, 0);
+            std::memcpy(&m_pending[offset], &header, sizeof(header));
+            if (!args.empty())
+                std::memcpy(&m_pending[offset + sizeof(header)], &args[0], args.size());
+            if (!result.empty())
+                std::memcpy(&m_pending[offset + sizeof(header) + argSize], &result[0], result.size());
+            m_appended += size;
+            bool wake = m_pending.size() >= m_batchBytes;
+            lk.unlock();
+            if (wake)
+                m_wake.notify_one();
+        }
+
+        //! Waits until every record appended so far is in the file.
+        void flush()
+        {
+            std::unique_lock<std::mutex> lk(m_mutex);
+            std::uint64_t target = m_appended;
+            ++m_flushWaiters;
+            m_wake.notify_one();
+            m_flushed.wait(lk, [&]() { return m_written >= target || m_failed; });
+            --m_flushWaiters;
+            if (m_failed)
+                BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_writer: write failed"));
+        }
+
+    private:
+
+        void run()
+        {
+            std::vector<char> batch;
+            std::unique_lock<std::mutex> lk(m_mutex);
+            for (;;)
+            {
+                m_wake.wait_for(lk, std::chrono::milliseconds(10), [this]() { return m_stop || m_flushWaiters || m_pending.size() >= m_batchBytes; });
+                if (!m_pending.empty())
+                {
+                    batch.swap(m_pending);
+                    std::uint64_t upTo = m_appended;
+                    lk.unlock();
+                    bool ok = static_cast<bool>(m_file.write(&batch[0], batch.size()).flush());
+                    batch.clear();
+                    lk.lock();
+                    m_written = upTo;
+                    m_failed = m_failed || !ok;
+                    m_flushed.notify_all();
+                }
+                else if (m_flushWaiters)
+                    m_flushed.notify_all();
+
+                if (m_stop && m_pending.empty())
+                    break;
+            }
+        }
+
+        std::ofstream           m_file;
+        std::size_t             m_batchBytes;
+        std::mutex              m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_flushed;
+        std::vector<char>       m_pending;
+        std::uint64_t           m_appended;
+        std::uint64_t           m_written;
+        int                     m_flushWaiters;
+        bool                    m_failed;
+        bool                    m_stop;
+        std::thread             m_thread;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class capture_reader
+    //! \brief Serves recorded results from a memory mapped capture file.
+    //! Opening the file indexes the record headers by member function; results are then read in place.
+    //! Each member function's records are returned in the order they were recorded. A call whose arguments
+    //! differ from the recorded ones, or which has run out of records, throws std::runtime_error.
+    class capture_reader : boost::noncopyable
+    {
+        struct site_records
+        {
+            site_records() : cursor(0) {}
+            std::vector<const detail::capture_record_header*> records;
+            std::atomic<std::size_t>                          cursor;
+        };
+
+    public:
+
+        explicit capture_reader(const std::string& path)
+            : m_size(0)
+        {
+            try
+            {
+                m_file = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+                m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_only);
+            }
+            catch (const boost::interprocess::interprocess_exception&)
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_reader: cannot map " + path));
+            }
+
+            const char* p = static_cast<const char*>(m_region.get_address());
+            const char* end = p + m_region.get_size();
+            if (end - p < static_cast<std::ptrdiff_t>(sizeof(detail::capture_magic)) || std::memcmp(p, detail::capture_magic, sizeof(detail::capture_magic)) != 0)
+                BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_reader: not a capture file " + path));
+
+            for (p += sizeof(detail::capture_magic); end - p >= static_cast<std::ptrdiff_t>(sizeof(detail::capture_record_header)); ++m_size)
+            {
+                const detail::capture_record_header* pHeader = reinterpret_cast<const detail::capture_record_header*>(p);
+                std::size_t size = sizeof(*pHeader) + detail::capture_padded(pHeader->argBytes) + detail::capture_padded(pHeader->resultBytes);
+                if (static_cast<std::size_t>(end - p) < size)
+                    BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_reader: truncated capture file " + path));
+                boost::shared_ptr<site_records>& pSite = m_sites[pHeader->site];
+                if (!pSite)
+                    pSite = boost::make_shared<site_records>();
+                pSite->records.push_back(pHeader);
+                p += size;
+            }
+        }
+
+        //! The number of records in the file.
+        std::size_t size() const { return m_size; }
+
+        template <typename R, typename... Args>
+        R next(std::uint64_t site, const Args&... args) const
+        {
+            boost::unordered_map<std::uint64_t, boost::shared_ptr<site_records> >::const_iterator it = m_sites.find(site);
+            if (it == m_sites.end())
+                BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_reader: no recorded call left to replay"));
+
+            //! The cursor only moves past a record whose arguments match, so a mismatched call can be retried.
+            site_records& records = *it->second;
+            static thread_local std::vector<char> t_buffer;
+            std::size_t index = records.cursor.load(std::memory_order_relaxed);
+            const detail::capture_record_header* pHeader;
+            do
+            {
+                if (index >= records.records.size())
+                    BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_reader: no recorded call left to replay"));
+                pHeader = records.records[index];
+                if (!detail::capture_args_match(t_buffer, reinterpret_cast<const char*>(pHeader + 1), pHeader->argBytes, args...))
+                    BOOST_THROW_EXCEPTION(std::runtime_error("nvm::capture_reader: arguments differ from the recorded call"));
+            }
+            while (!records.cursor.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+
+            return detail::capture_result<R>::read(reinterpret_cast<const char*>(pHeader + 1) + detail::capture_padded(pHeader->argBytes));
+        }
+
+    private:
+
+        boost::interprocess::file_mapping                                       m_file;
+        boost::interprocess::mapped_region                                      m_region;
+        boost::unordered_map<std::uint64_t, boost::shared_ptr<site_records> >   m_sites;
+        std::size_t                                                             m_size;
+    };
+
+    template <typename T>
+    class capture_mock;
+
+    namespace detail
+    {
+        template <typename MockType, typename MFN, typename Sig>
+        class captured_call;
+
+        //! Records through, or replays for, the capture_mock it is bound to.
+        template <typename MockType, typename MFN, typename R, typename... Params>
+        class captured_call<MockType, MFN, R(Params...)>
+        {
+        public:
+
+            captured_call(MFN mfn, MockType* pMock, std::size_t siteId, std::uint64_t siteHash)
+                : m_mfn(mfn)
+                , m_pMock(pMock)
+                , m_siteId(siteId)
+                , m_siteHash(siteHash)
+            {}
+
+            R operator()(Params... params) const
+            {
+                if (const capture_reader* pReader = m_pMock->get_capture_reader())
+                    return pReader->template next<R>(m_siteHash, params...);
+
+                //! Arguments are encoded before the call as the real implementation may move from them.
+                std::vector<char> args;
+                write_capture_args(args, params...);
+                scoped_pass_through passThrough(m_siteId);
+                MockType* pMock = m_pMock;
+                MFN mfn = m_mfn;
+                return capture_result<R>::record(*m_pMock->get_capture_writer(), m_siteHash, args, [&]() -> R
+                {
+                    return (pMock->*mfn)(std::forward<Params>(params)...);
+                });
+            }
+
+        private:
+
+            MFN           m_mfn;
+            MockType*     m_pMock;
+            std::size_t   m_siteId;
+            std::uint64_t m_siteHash;
+        };
+
+        template <typename T, typename MockType, typename MFN>
+        class captured_mocker : public mocker
+        {
+        public:
+
+            captured_mocker(MFN mfn, std::size_t siteId, std::uint64_t siteHash)
+                : m_mfn(mfn)
+                , m_siteId(siteId)
+                , m_siteHash(siteHash)
+            {}
+
+            boost::shared_ptr<mock_function_base> operator()(void* pThis) const
+            {
+                typedef typename signature_of_mem_fn<MFN>::type sig_type;
+                MockType* pMock = static_cast<MockType*>(static_cast<mock<T>*>(pThis));
+                return boost::make_shared< mock_function<sig_type> >(captured_call<MockType, MFN, sig_type>(m_mfn, pMock, m_siteId, m_siteHash));
+            }
+
+        private:
+
+            MFN           m_mfn;
+            std::size_t   m_siteId;
+            std::uint64_t m_siteHash;
+        };
+
+    }//! namespace detail;
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class capture_mock
+    //! \brief A mock which records calls to the real implementation or replays them.
+    //! Derive from capture_mock<T> and register the member functions to capture in the constructor with
+    //! NVM_REGISTER_CAPTURED_MEMBER_FUNCTION. Further constructor arguments are passed to T.
+    //! Example usage:
+    //! \code
+    //! struct CapturedPricer : nvm::capture_mock<Pricer>
+    //! {
+    //!     template <typename Capture>
+    //!     CapturedPricer(Capture& c) : nvm::capture_mock<Pricer>(c)
+    //!     {
+    //!         NVM_ONCE_BLOCK()
+    //!         {
+    //!             NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(Pricer, CapturedPricer, Price);
+    //!         }
+    //!     }
+    //! };
+    //! \endcode
+    template <typename T>
+    class capture_mock : public mock<T>
+    {
+    public:
+
+        template <typename... Args>
+        capture_mock(capture_writer& writer, Args&&... args)
+            : mock<T>(std::forward<Args>(args)...)
+            , m_pWriter(&writer)
+            , m_pReader(0)
+        {}
+
+        template <typename... Args>
+        capture_mock(const capture_reader& reader, Args&&... args)
+            : mock<T>(std::forward<Args>(args)...)
+            , m_pWriter(0)
+            , m_pReader(&reader)
+        {}
+
+        capture_writer*       get_capture_writer() const { return m_pWriter; }
+        const capture_reader* get_capture_reader() const { return m_pReader; }
+
+    protected:
+
+        template <typename MockType, typename MFN>
+        static void register_captured_mocker(MFN mfn, const std::string& mfName)
+        {
+            mock_site& site = get_mock_site(mfn, mfName);
+            detail::set_mock_type_mocker<MockType>(site, boost::make_shared< detail::captured_mocker<T, MockType, MFN> >(mfn, site.id(), detail::capture_site_hash(site.key())));
+        }
+
+    private:
+
+        capture_writer*       m_pWriter;
+        const capture_reader* m_pReader;
+    };
+
+}//! namespace nvm;
+
+//! \def NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(OriginalType, MockType, MemberFn)
+//! \brief Registers a member function of a capture_mock to be recorded or replayed.
+#define NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(OriginalType, MockType, MemberFn)                                                 \
+    register_captured_mocker<MockType>(&OriginalType::MemberFn, BOOST_PP_STRINGIZE(OriginalType::MemberFn))                     \
+/***/
+
+//! \def NVM_REGISTER_CAPTURED_OVERLOADED_MEMBER_FUNCTION(OriginalType, MockType, MemberFn, Signature)
+//! \brief Registers an overloaded non-const member function of a capture_mock.
+#define NVM_REGISTER_CAPTURED_OVERLOADED_MEMBER_FUNCTION(OriginalType, MockType, MemberFn, Signature)                          \
+    register_captured_mocker<MockType>                                                                                          \
+    (                                                                                                                           \
+        static_cast<nvm::mem_fn_ptr_gen<Signature>::template apply<OriginalType>::type>(&OriginalType::MemberFn)                \
+      , BOOST_PP_STRINGIZE(OriginalType::MemberFn)                                                                              \
+    )                                                                                                                           \
+/***/
+
+//! \def NVM_REGISTER_CAPTURED_OVERLOADED_CONST_MEMBER_FUNCTION(OriginalType, MockType, MemberFn, Signature)
+//! \brief Registers an overloaded const member function of a capture_mock.
+#define NVM_REGISTER_CAPTURED_OVERLOADED_CONST_MEMBER_FUNCTION(OriginalType, MockType, MemberFn, Signature)                    \
+    register_captured_mocker<MockType>                                                                                          \
+    (                                                                                                                           \
+        static_cast<nvm::mem_fn_ptr_gen<Signature>::template apply<OriginalType>::const_type>(&OriginalType::MemberFn)          \
+      , BOOST_PP_STRINGIZE(OriginalType::MemberFn)                                                                              \
+    )                                                                                                                           \
+/***/
+
+#endif // NVM_CAPTURE_HPP
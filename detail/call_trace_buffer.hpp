@@ -0,0 +1,318 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_CALLTRACEBUFFER_HPP
+#define NVM_DETAIL_CALLTRACEBUFFER_HPP
+#pragma once
+
+#include "config.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/static_assert.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#if defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+    #error "NVM call tracing requires variadic templates."
+#endif
+
+//! \def NVM_CALL_TRACE_CAPACITY
+//! \brief The number of calls each thread's ring buffer holds between drains. Must be a power of two.
+#if !defined(NVM_CALL_TRACE_CAPACITY)
+    #define NVM_CALL_TRACE_CAPACITY 4096
+#endif
+
+//! \def NVM_CALL_TRACE_ARG_BYTES
+//! \brief The number of bytes of argument data copied into each call record.
+#if !defined(NVM_CALL_TRACE_ARG_BYTES)
+    #define NVM_CALL_TRACE_ARG_BYTES 32
+#endif
+
+namespace nvm
+{
+    //! \struct call_record
+    //! \brief One intercepted call.
+    //! Trivially copyable arguments are packed into args, in order, while they fit. Bit i of argMask is set
+    //! when argument i was copied; other arguments are only counted.
+    struct call_record
+    {
+        std::uint64_t timestamp;                        //! steady_clock time in nanoseconds.
+        const void*   pObject;                          //! The object the member function was called on.
+        std::uint32_t siteId;                           //! mock_site::id() of the member function.
+        std::uint32_t threadIndex;                      //! Index of the recording thread's buffer.
+        std::uint16_t argCount;
+        std::uint16_t argMask;
+        std::uint16_t argBytes;
+        unsigned char args[NVM_CALL_TRACE_ARG_BYTES];
+    };
+
+    namespace detail
+    {
+        //! \class call_trace_buffer
+        //! \brief Single producer ring buffer of call_records owned by one thread.
+        //! push is wait-free and does not allocate: the owning thread writes the slot and publishes it with a
+        //! per slot sequence number. A drain running concurrently detects slots which were overwritten while
+        //! it read them and counts them as dropped, as it does records overwritten before it got to them.
+        //! Records are stored as relaxed atomic words so that a read racing with an overwrite is not a data
+        //! race; the sequence number then tells the drain to discard what it read.
+        class call_trace_buffer
+        {
+            BOOST_STATIC_ASSERT_MSG((NVM_CALL_TRACE_CAPACITY & (NVM_CALL_TRACE_CAPACITY - 1)) == 0, "NVM_CALL_TRACE_CAPACITY must be a power of two.");
+            BOOST_STATIC_ASSERT(std::is_trivially_copyable<call_record>::value);
+
+            static const std::size_t record_words = (sizeof(call_record) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+            struct slot
+            {
+                slot() : seq(0)
+                {
+                    for (std::size_t i = 0; i < record_words; ++i)
+                        words[i].store(0, std::memory_order_relaxed);
+                }
+
+                std::atomic<std::uint64_t> seq;
+                std::atomic<std::uint64_t> words[record_words];
+            };
+
+        public:
+
+            explicit call_trace_buffer(std::uint32_t threadIndex)
+                : m_threadIndex(threadIndex)
+                , m_head(0)
+                , m_slots(NVM_CALL_TRACE_CAPACITY)
+                , m_drained(0)
+                , m_retired(false)
+            {}
+
+            std::uint32_t thread_index() const { return m_threadIndex; }
+
+            //! Called only by the owning thread.
+            void push(const call_record& record)
+            {
+                std::uint64_t words[record_words] = {};
+                std::memcpy(words, &record, sizeof(record));
+
+                std::uint64_t n = m_head.load(std::memory_order_relaxed);
+                slot& s = m_slots[n & (NVM_CALL_TRACE_CAPACITY - 1)];
+                s.seq.store(2 * n + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                for (std::size_t i = 0; i < record_words; ++i)
+                    s.words[i].store(words[i], std::memory_order_relaxed);
+                s.seq.store(2 * n + 2, std::memory_order_release);
+                m_head.store(n + 1, std::memory_order_release);
+            }
+
+            //! Appends the records pushed since the last drain and returns the number lost to overwrites.
+            //! Drains are serialized by the call_trace_registry.
+            std::size_t drain(std::vector<call_record>& records)
+            {
+                std::uint64_t head = m_head.load(std::memory_order_acquire);
+                std::uint64_t start = head > NVM_CALL_TRACE_CAPACITY ? head - NVM_CALL_TRACE_CAPACITY : 0;
+                if (start < m_drained)
+                    start = m_drained;
+                std::size_t dropped = static_cast<std::size_t>(start - m_drained);
+                for (std::uint64_t n = start; n != head; ++n)
+                {
+                    const slot& s = m_slots[n & (NVM_CALL_TRACE_CAPACITY - 1)];
+                    if (s.seq.load(std::memory_order_acquire) != 2 * n + 2)
+                    {
+                        ++dropped;
+                        continue;
+                    }
+                    std::uint64_t words[record_words];
+                    for (std::size_t i = 0; i < record_words; ++i)
+                        words[i] = s.words[i].load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (s.seq.load(std::memory_order_relaxed) != 2 * n + 2)
+                    {
+                        ++dropped;
+                        continue;
+                    }
+                    call_record record;
+                    std::memcpy(&record, words, sizeof(record));
+                    records.push_back(record);
+                }
+                m_drained = head;
+                return dropped;
+            }
+
+            //! Called when the owning thread exits; the buffer is released once it has been drained.
+            void retire() { m_retired.store(true, std::memory_order_release); }
+            bool retired() const { return m_retired.load(std::memory_order_acquire); }
+
+        private:
+
+            std::uint32_t              m_threadIndex;
+            std::atomic<std::uint64_t> m_head;
+            std::vector<slot>          m_slots;
+            std::uint64_t              m_drained;
+            std::atomic<bool>          m_retired;
+        };
+
+        //! \class call_trace_registry
+        //! \brief Tracks the buffers of every thread which has recorded a call.
+        class call_trace_registry
+        {
+        public:
+
+            call_trace_registry()
+                : m_nextThreadIndex(0)
+            {}
+
+#if defined(NVM_SHARED_REGISTRY)
+            //! Defined in src/registry.cpp.
+            NVM_REGISTRY_DECL static call_trace_registry& instance();
+#else
+            static call_trace_registry& instance()
+            {
+                static call_trace_registry s_instance;
+                return s_instance;
+            }
+#endif
+
+            boost::shared_ptr<call_trace_buffer> create_buffer()
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                boost::shared_ptr<call_trace_buffer> pBuffer = boost::make_shared<call_trace_buffer>(static_cast<std::uint32_t>(m_nextThreadIndex++));
+                m_buffers.push_back(pBuffer);
+                return pBuffer;
+            }
+
+            std::size_t drain(std::vector<call_record>& records)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                std::size_t dropped = 0;
+                for (std::size_t i = 0; i < m_buffers.size();)
+                {
+                    //! Read the flag first so that a buffer retired during the drain is drained once more.
+                    bool retired = m_buffers[i]->retired();
+                    dropped += m_buffers[i]->drain(records);
+                    if (retired)
+                    {
+                        m_buffers[i] = m_buffers.back();
+                        m_buffers.pop_back();
+                    }
+                    else
+                        ++i;
+                }
+                return dropped;
+            }
+
+        private:
+
+            std::mutex                                          m_mutex;
+            std::vector< boost::shared_ptr<call_trace_buffer> > m_buffers;
+            std::size_t                                         m_nextThreadIndex;
+        };
+
+#if defined(NVM_SHARED_REGISTRY)
+        //! Defined in src/registry.cpp.
+        NVM_REGISTRY_DECL extern std::atomic<bool> shared_call_trace_enabled;
+
+        inline std::atomic<bool>& call_trace_flag()
+        {
+            return shared_call_trace_enabled;
+        }
+#else
+        inline std::atomic<bool>& call_trace_flag()
+        {
+            static std::atomic<bool> s_enabled(false);
+            return s_enabled;
+        }
+#endif
+
+        //! Registers the calling thread's buffer and arranges for it to be retired when the thread exits.
+        BOOST_NOINLINE inline call_trace_buffer& acquire_thread_trace_buffer()
+        {
+            struct handle
+            {
+                ~handle() { pBuffer->retire(); }
+                boost::shared_ptr<call_trace_buffer> pBuffer;
+            };
+            static thread_local handle t_handle = { call_trace_registry::instance().create_buffer() };
+            return *t_handle.pBuffer;
+        }
+
+        //! The cached pointer is trivially destructible, so the common case pays no thread_local guard.
+        inline call_trace_buffer& thread_trace_buffer()
+        {
+            static thread_local call_trace_buffer* t_pBuffer = 0;
+            if (BOOST_UNLIKELY(!t_pBuffer))
+                t_pBuffer = &acquire_thread_trace_buffer();
+            return *t_pBuffer;
+        }
+
+        //! \class call_recorder
+        //! \brief Builds a call_record from an intercept's arguments and pushes it to the thread's buffer.
+        class call_recorder
+        {
+        public:
+
+            call_recorder(std::size_t siteId, const void* pObject)
+                : m_siteId(siteId)
+                , m_pObject(pObject)
+            {}
+
+            template <typename... Args>
+            void operator()(const Args&... args) const
+            {
+                call_record record;
+                record.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+                record.pObject = m_pObject;
+                record.siteId = static_cast<std::uint32_t>(m_siteId);
+                record.threadIndex = 0;
+                record.argCount = static_cast<std::uint16_t>(sizeof...(Args));
+                record.argMask = 0;
+                record.argBytes = 0;
+                std::size_t index = 0;
+                int expand[] = { 0, (pack(record, index++, args, std::is_trivially_copyable<Args>()), 0)... };
+                (void)expand;
+
+                call_trace_buffer& buffer = thread_trace_buffer();
+                record.threadIndex = buffer.thread_index();
+                buffer.push(record);
+            }
+
+        private:
+
+            template <typename T>
+            static void pack(call_record&, std::size_t, const T&, std::false_type)
+            {}
+
+            template <typename T>
+            static void pack(call_record& record, std::size_t index, const T& arg, std::true_type)
+            {
+                if (index < 16 && record.argBytes + sizeof(T) <= NVM_CALL_TRACE_ARG_BYTES)
+                {
+                    std::memcpy(record.args + record.argBytes, &arg, sizeof(T));
+                    record.argBytes = static_cast<std::uint16_t>(record.argBytes + sizeof(T));
+                    record.argMask = static_cast<std::uint16_t>(record.argMask | (1u << index));
+                }
+            }
+
+            std::size_t m_siteId;
+            const void* m_pObject;
+        };
+
+    }//! namespace detail;
+
+    //! \brief Returns true if intercepted calls are being recorded.
+    //! Only meaningful in code compiled with NVM_ENABLE_CALL_TRACE.
+    inline bool call_trace_enabled()
+    {
+        return detail::call_trace_flag().load(std::memory_order_relaxed);
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_CALLTRACEBUFFER_HPP
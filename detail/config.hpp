@@ -0,0 +1,55 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_CONFIG_HPP
+#define NVM_DETAIL_CONFIG_HPP
+#pragma once
+
+#include <boost/config.hpp>
+
+//! \def NVM_HAS_VARIADIC_TEMPLATES
+//! \brief Defined when the variadic implementations of the factory and traits are used.
+//! Define NVM_NO_VARIADIC_TEMPLATES to force the preprocessed arity specializations.
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES) && !defined(NVM_NO_VARIADIC_TEMPLATES)
+    #define NVM_HAS_VARIADIC_TEMPLATES
+#endif
+
+//! \def NVM_TYPEOF(Expr)
+//! \brief The type of an expression, using decltype where available instead of Boost.Typeof.
+#if !defined(BOOST_NO_CXX11_DECLTYPE)
+    #define NVM_TYPEOF(Expr) decltype(Expr)
+#else
+    #include <boost/typeof/typeof.hpp>
+    #define NVM_TYPEOF(Expr) BOOST_TYPEOF(Expr)
+#endif
+
+//! \def NVM_TYPENAME
+//! \brief typename where the language allows it outside of templates (C++11), so that the intercept macros can
+//! name dependent types when used in the member functions of class templates.
+#if !defined(BOOST_NO_CXX11_DECLTYPE)
+    #define NVM_TYPENAME typename
+#else
+    #define NVM_TYPENAME
+#endif
+
+//! \def NVM_SHARED_REGISTRY
+//! \brief Define NVM_SHARED_REGISTRY in every module of a process to share one mocker registry and live mock
+//! counter between the executable and its shared libraries and plugins. The definitions are then exported
+//! from the nvmock_registry library (src/registry.cpp) rather than instantiated in each module, so a mock
+//! registered in one module is seen by intercept sites compiled into any other.
+//! \def NVM_REGISTRY_DECL
+//! \brief Export/import decoration for the shared registry symbols.
+#if defined(NVM_SHARED_REGISTRY)
+    #if defined(NVM_REGISTRY_SOURCE)
+        #define NVM_REGISTRY_DECL BOOST_SYMBOL_EXPORT
+    #else
+        #define NVM_REGISTRY_DECL BOOST_SYMBOL_IMPORT
+    #endif
+#endif
+
+#endif // NVM_DETAIL_CONFIG_HPP
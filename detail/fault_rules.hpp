@@ -0,0 +1,505 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_FAULTRULES_HPP
+#define NVM_DETAIL_FAULTRULES_HPP
+#pragma once
+
+#include "config.hpp"
+#include "thread/virtual_scheduler.hpp"
+#include <boost/assert.hpp>
+#include <boost/function_types/result_type.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/throw_exception.hpp>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace nvm
+{
+    //! \class injected_fault
+    //! \brief Thrown from an intercept site by a throw rule (see fault_injection.hpp).
+    class injected_fault : public std::runtime_error
+    {
+    public:
+
+        injected_fault(const std::string& site, const std::string& message)
+            : std::runtime_error(site + ": " + message)
+            , m_site(site)
+        {}
+
+        const std::string& site() const { return m_site; }
+
+    private:
+
+        std::string m_site;
+    };
+
+    //! \struct fault_value
+    //! \brief Converts the value of a return rule to the result type of an intercepted function.
+    //! Arithmetic types and std::string are supported. Specialize for other types. At sites whose result
+    //! type has no conversion return rules are ignored.
+    template <typename R, typename Enable = void>
+    struct fault_value
+    {
+        static bool parse(const std::string&, boost::optional<R>&) { return false; }
+    };
+
+    template <typename R>
+    struct fault_value<R, typename std::enable_if<std::is_arithmetic<R>::value>::type>
+    {
+        static bool parse(const std::string& text, boost::optional<R>& value)
+        {
+            R v;
+            if (!boost::conversion::try_lexical_convert(text, v))
+                return false;
+            value = v;
+            return true;
+        }
+    };
+
+    template <>
+    struct fault_value<bool>
+    {
+        static bool parse(const std::string& text, boost::optional<bool>& value)
+        {
+            if (text == "true" || text == "1")
+                value = true;
+            else if (text == "false" || text == "0")
+                value = false;
+            else
+                return false;
+            return true;
+        }
+    };
+
+    template <>
+    struct fault_value<std::string>
+    {
+        static bool parse(const std::string& text, boost::optional<std::string>& value)
+        {
+            value = text;
+            return true;
+        }
+    };
+
+    namespace detail
+    {
+        //! The value an injected return rule hands back to the intercept.
+        template <typename R>
+        class injected_result
+        {
+        public:
+
+            bool set(const std::string& text) { return fault_value<typename std::decay<R>::type>::parse(text, m_value); }
+            typename std::decay<R>::type get() { return *m_value; }
+
+        private:
+
+            boost::optional<typename std::decay<R>::type> m_value;
+        };
+
+        //! A return rule at a void function skips the call.
+        template <>
+        class injected_result<void>
+        {
+        public:
+
+            bool set(const std::string&) { return true; }
+            void get() {}
+        };
+
+        //! References cannot be made up from text, so return rules are ignored at such sites and get is
+        //! never called; reaching it aborts.
+        template <typename R>
+        class injected_result<R&>
+        {
+        public:
+
+            bool set(const std::string&) { return false; }
+            R& get() { BOOST_ASSERT(false); std::abort(); }
+        };
+
+        //! SplitMix64 finalizer: a cheap, well mixed hash of the call ordinal.
+        inline std::uint64_t mix_bits(std::uint64_t x)
+        {
+            x += 0x9e3779b97f4a7c15ull;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+
+        //! FNV-1a, used to give each rule a salt which is stable between runs.
+        inline std::uint64_t hash_string(const std::string& s)
+        {
+            std::uint64_t h = 0xcbf29ce484222325ull;
+            for (std::size_t i = 0; i < s.size(); ++i)
+                h = (h ^ static_cast<unsigned char>(s[i])) * 0x100000001b3ull;
+            return h;
+        }
+
+        enum fault_action
+        {
+            fault_delay,    //! Sleep, then carry on with the call.
+            fault_throw,    //! Throw injected_fault.
+            fault_return    //! Return a value without running the call.
+        };
+
+        //! \class fault_rule
+        //! \brief One rule for a site. Whether the n-th call evaluated by the rule fires is a function of the
+        //! seed, the rule and n only, so a run with the same seed and the same call order injects the same faults.
+        class fault_rule
+        {
+        public:
+
+            fault_rule(fault_action action, const std::string& value, std::chrono::nanoseconds delay, double rate, std::uint64_t salt)
+                : m_action(action)
+                , m_value(value)
+                , m_delay(delay)
+                , m_rate(rate)
+                , m_always(rate >= 1.0)
+                , m_threshold(rate > 0.0 && rate < 1.0 ? static_cast<std::uint64_t>(rate * 18446744073709551616.0) : 0)
+                , m_salt(salt)
+                , m_calls(0)
+            {}
+
+            fault_rule(const fault_rule& other)
+                : m_action(other.m_action)
+                , m_value(other.m_value)
+                , m_delay(other.m_delay)
+                , m_rate(other.m_rate)
+                , m_always(other.m_always)
+                , m_threshold(other.m_threshold)
+                , m_salt(other.m_salt)
+                , m_calls(other.m_calls.load(std::memory_order_relaxed))
+            {}
+
+            fault_action                action() const { return m_action; }
+            const std::string&          value() const { return m_value; }
+            std::chrono::nanoseconds    delay() const { return m_delay; }
+            double                      rate() const { return m_rate; }
+
+            bool sample() const
+            {
+                if (m_always)
+                    return true;
+                std::uint64_t n = m_calls.fetch_add(1, std::memory_order_relaxed);
+                return mix_bits(m_salt ^ mix_bits(n)) < m_threshold;
+            }
+
+        private:
+
+            fault_action                        m_action;
+            std::string                         m_value;
+            std::chrono::nanoseconds            m_delay;
+            double                              m_rate;
+            bool                                m_always;
+            std::uint64_t                       m_threshold;
+            std::uint64_t                       m_salt;
+            mutable std::atomic<std::uint64_t>  m_calls;
+        };
+
+        //! The rules of one site, applied in the order they were given.
+        struct site_faults
+        {
+            std::string             name;
+            std::vector<fault_rule> rules;
+
+            template <typename R>
+            bool apply(injected_result<R>& result) const
+            {
+                for (std::size_t i = 0; i < rules.size(); ++i)
+                {
+                    const fault_rule& rule = rules[i];
+                    if (!rule.sample())
+                        continue;
+                    switch (rule.action())
+                    {
+                    case fault_delay:
+                        sleep_for(rule.delay());
+                        break;
+                    case fault_throw:
+                        BOOST_THROW_EXCEPTION(injected_fault(name, rule.value()));
+                    case fault_return:
+                        if (result.set(rule.value()))
+                            return true;
+                        break;
+                    }
+                }
+                return false;
+            }
+        };
+
+        //! Parses a duration such as 250us, 5ms or 1s (nanoseconds if there is no unit).
+        inline bool parse_fault_delay(const std::string& text, std::chrono::nanoseconds& delay)
+        {
+            std::size_t end = 0;
+            while (end < text.size() && (std::isdigit(static_cast<unsigned char>(text[end])) || text[end] == '.'))
+                ++end;
+            double count = 0;
+            if (end == 0 || !boost::conversion::try_lexical_convert(text.substr(0, end), count))
+                return false;
+            std::string unit = text.substr(end);
+            double scale = unit.empty() || unit == "ns" ? 1 : unit == "us" ? 1e3 : unit == "ms" ? 1e6 : unit == "s" ? 1e9 : 0;
+            if (scale == 0)
+                return false;
+            delay = std::chrono::nanoseconds(static_cast<std::int64_t>(count * scale));
+            return true;
+        }
+
+        //! \class fault_registry
+        //! \brief The fault rules of the process, keyed by site name (OriginalType::MemberFn as written at the intercept).
+        //! Each intercept site looks up its slot once; the rules in a slot are replaced atomically when rules are
+        //! (re)loaded. Rule sets are retained for the lifetime of the registry as sites may still be applying them.
+        //! On construction the registry loads NVM_FAULTS_FILE (a file of rules) and NVM_FAULTS (rules separated by
+        //! semicolons) from the environment.
+        class fault_registry : boost::noncopyable
+        {
+            typedef std::atomic<const site_faults*> slot;
+
+        public:
+
+            fault_registry()
+                : m_enabled(false)
+            {
+                std::string rules;
+                if (const char* path = std::getenv("NVM_FAULTS_FILE"))
+                {
+                    std::ifstream is(path);
+                    if (!is)
+                        std::cerr << "nvm: cannot open NVM_FAULTS_FILE " << path << std::endl;
+                    else
+                    {
+                        std::stringstream ss;
+                        ss << is.rdbuf();
+                        rules = ss.str();
+                    }
+                }
+                if (const char* text = std::getenv("NVM_FAULTS"))
+                {
+                    rules += '\n';
+                    for (const char* p = text; *p; ++p)
+                        rules += *p == ';' ? '\n' : *p;
+                }
+
+                if (!rules.empty())
+                {
+                    try
+                    {
+                        std::istringstream is(rules);
+                        load(is);
+                    }
+                    catch (const std::invalid_argument& e)
+                    {
+                        std::cerr << "nvm: fault rules ignored: " << e.what() << std::endl;
+                    }
+                }
+            }
+
+            ~fault_registry()
+            {
+                for (std::size_t i = 0; i < m_retained.size(); ++i)
+                    delete m_retained[i];
+                for (std::map<std::string, slot*>::iterator it = m_slots.begin(); it != m_slots.end(); ++it)
+                    delete it->second;
+            }
+
+#if defined(NVM_SHARED_REGISTRY)
+            //! Defined in src/registry.cpp.
+            NVM_REGISTRY_DECL static fault_registry& instance();
+#else
+            static fault_registry& instance()
+            {
+                static fault_registry s_instance;
+                return s_instance;
+            }
+#endif
+
+            bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+            //! The slot of a site. Its address is stable for the lifetime of the registry.
+            const slot& get_slot(const std::string& name)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                return get_slot_locked(name);
+            }
+
+            //! Replaces every rule with those read from is.
+            //! Each line is a site name followed by one action and optionally a sampling rate:
+            //! \code
+            //! # Comments start with '#'. The seed makes sampling reproducible (default 0).
+            //! seed=42
+            //! Service::Fetch delay=5ms rate=0.1
+            //! Service::Fetch throw=backend unavailable rate=0.01
+            //! Cache::Get return=0 rate=0.5
+            //! \endcode
+            //! throw takes the rest of the line (less a trailing rate) as its message.
+            //! \throws std::invalid_argument naming the line if a rule cannot be parsed; no rules are changed.
+            void load(std::istream& is)
+            {
+                std::uint64_t seed = 0;
+                std::map<std::string, site_faults*> loaded;
+                std::string line;
+                try
+                {
+                    for (std::size_t lineNo = 1; std::getline(is, line); ++lineNo)
+                        parse_line(line, lineNo, seed, loaded);
+                }
+                catch (...)
+                {
+                    for (std::map<std::string, site_faults*>::iterator it = loaded.begin(); it != loaded.end(); ++it)
+                        delete it->second;
+                    throw;
+                }
+
+                std::lock_guard<std::mutex> lk(m_mutex);
+                for (std::map<std::string, slot*>::iterator it = m_slots.begin(); it != m_slots.end(); ++it)
+                    it->second->store(0, std::memory_order_release);
+                for (std::map<std::string, site_faults*>::iterator it = loaded.begin(); it != loaded.end(); ++it)
+                {
+                    //! Salts are fixed once the seed is known, which may be set after the rules.
+                    std::vector<fault_rule> rules;
+                    rules.reserve(it->second->rules.size());
+                    for (std::size_t i = 0; i < it->second->rules.size(); ++i)
+                        rules.push_back(with_seed(it->second->rules[i], seed, it->first, i));
+                    it->second->rules.swap(rules);
+                    m_retained.push_back(it->second);
+                    get_slot_locked(it->first).store(it->second, std::memory_order_release);
+                }
+                m_enabled.store(!loaded.empty(), std::memory_order_relaxed);
+            }
+
+            //! Removes every rule.
+            void clear()
+            {
+                std::istringstream is;
+                load(is);
+            }
+
+        private:
+
+            slot& get_slot_locked(const std::string& name)
+            {
+                std::map<std::string, slot*>::iterator it = m_slots.find(name);
+                if (it == m_slots.end())
+                    it = m_slots.insert(std::make_pair(name, new slot(0))).first;
+                return *it->second;
+            }
+
+            static fault_rule with_seed(const fault_rule& rule, std::uint64_t seed, const std::string& site, std::size_t index)
+            {
+                std::uint64_t salt = mix_bits(seed ^ hash_string(site)) + index;
+                return fault_rule(rule.action(), rule.value(), rule.delay(), rule.rate(), salt);
+            }
+
+            static void parse_line(const std::string& text, std::size_t lineNo, std::uint64_t& seed, std::map<std::string, site_faults*>& loaded)
+            {
+                std::string line = trim(text.substr(0, text.find('#')));
+                if (line.empty())
+                    return;
+
+                std::string error = "line " + boost::lexical_cast<std::string>(lineNo) + ": ";
+                if (line.compare(0, 5, "seed=") == 0)
+                {
+                    if (!boost::conversion::try_lexical_convert(line.substr(5), seed))
+                        BOOST_THROW_EXCEPTION(std::invalid_argument(error + "bad seed"));
+                    return;
+                }
+
+                std::size_t space = line.find_first_of(" \t");
+                if (space == std::string::npos)
+                    BOOST_THROW_EXCEPTION(std::invalid_argument(error + "expected a site and an action"));
+                std::string site = line.substr(0, space);
+                std::string rest = trim(line.substr(space));
+
+                //! A trailing rate applies to every action.
+                double rate = 1.0;
+                std::size_t ratePos = rest.rfind("rate=");
+                if (ratePos != std::string::npos && (ratePos == 0 || std::isspace(static_cast<unsigned char>(rest[ratePos - 1]))))
+                {
+                    if (!boost::conversion::try_lexical_convert(trim(rest.substr(ratePos + 5)), rate) || rate < 0.0 || rate > 1.0)
+                        BOOST_THROW_EXCEPTION(std::invalid_argument(error + "rate must be between 0 and 1"));
+                    rest = trim(rest.substr(0, ratePos));
+                }
+
+                std::size_t eq = rest.find('=');
+                std::string action = rest.substr(0, eq);
+                std::string value = eq == std::string::npos ? std::string() : rest.substr(eq + 1);
+                std::chrono::nanoseconds delay(0);
+                fault_action kind;
+                if (action == "delay")
+                {
+                    if (!parse_fault_delay(value, delay))
+                        BOOST_THROW_EXCEPTION(std::invalid_argument(error + "bad delay '" + value + "'"));
+                    kind = fault_delay;
+                }
+                else if (action == "throw")
+                    kind = fault_throw;
+                else if (action == "return")
+                    kind = fault_return;
+                else
+                    BOOST_THROW_EXCEPTION(std::invalid_argument(error + "unknown action '" + action + "'"));
+
+                site_faults*& pFaults = loaded[site];
+                if (!pFaults)
+                {
+                    pFaults = new site_faults;
+                    pFaults->name = site;
+                }
+                pFaults->rules.push_back(fault_rule(kind, value, delay, rate, 0));
+            }
+
+            static std::string trim(const std::string& s)
+            {
+                std::size_t first = s.find_first_not_of(" \t\r");
+                if (first == std::string::npos)
+                    return std::string();
+                return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+            }
+
+            std::atomic<bool>               m_enabled;
+            std::mutex                      m_mutex;
+            std::map<std::string, slot*>    m_slots;
+            std::vector<site_faults*>       m_retained;
+        };
+
+        //! The cold half of fault injection at an intercept site; only reached while rules are loaded.
+        //! \return true if the call is to return result instead of running.
+        template <typename SiteTag, typename R>
+        BOOST_NOINLINE bool inject_fault(const char* name, injected_result<R>& result)
+        {
+            static const std::atomic<const site_faults*>& slot = fault_registry::instance().get_slot(name);
+            const site_faults* pFaults = slot.load(std::memory_order_acquire);
+            return pFaults && pFaults->apply(result);
+        }
+
+    }//! namespace detail;
+
+    //! \brief Returns true if any fault rules are loaded.
+    //! Only meaningful in code compiled with NVM_ENABLE_FAULT_INJECTION.
+    inline bool fault_injection_enabled()
+    {
+        return detail::fault_registry::instance().enabled();
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_FAULTRULES_HPP
@@ -10,7 +10,11 @@
 #define NVM_MAX_MEMBER_FUNCTION_TRAIT_PARAMS 10
 #endif
 
-#if !defined(NVM_DONT_USE_PREPROCESSED_FILES)
+#include "config.hpp"
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+#include "variadic/member_function_traits.hpp"
+#elif !defined(NVM_DONT_USE_PREPROCESSED_FILES)
 #include "preprocessed/member_function_traits.hpp"
 #else
 
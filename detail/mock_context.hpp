@@ -0,0 +1,278 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKCONTEXT_HPP
+#define NVM_DETAIL_MOCKCONTEXT_HPP
+#pragma once
+
+#include "config.hpp"
+#include "mocker_registry.hpp"
+#include <boost/container/flat_set.hpp>
+#include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nvm
+{
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class mock_context
+    //! \brief An isolated set of mock registrations.
+    //! While a context is bound to a thread (see scoped_mock_context) mockers registered on that thread go into
+    //! the context instead of the process wide registry, NVM_ONCE_BLOCKs run once per context rather than once
+    //! per process, and mocks constructed on the thread dispatch through the context's mockers. Threads bound
+    //! to different contexts can therefore register different mocks for the same member function concurrently.
+    //! Mock tables (see mock_table.hpp) are loaded once per process and apply in every context; a mocker
+    //! registered in the context takes precedence over the table's.
+    //! Mocks must not outlive the context they were constructed in.
+    //! Lookups are lock-free loads through a radix tree indexed by mock_site::id() (see context_dispatch);
+    //! registration takes a lock and writes the site's slot in place.
+    //!
+    //! The registrations of a context, including which once blocks it has entered, can be captured with
+    //! get_snapshot and reinstated with restore or by constructing another context from the snapshot. Both
+    //! swap pointers rather than repeat the registrations, so a fixture can register an expensive baseline
+    //! once and give each test a context which starts from it. Nodes of the tree shared with a snapshot are
+    //! not written again; a later registration copies the nodes on its site's path instead:
+    //! \code
+    //! static nvm::mock_context::snapshot s_baseline; //! Registered once, e.g. in SetUpTestSuite.
+    //! nvm::mock_context context(s_baseline);         //! Per test; registrations made here do not leak.
+    //! \endcode
+    class mock_context : public detail::context_dispatch, boost::noncopyable
+    {
+        typedef boost::container::flat_set<const void*> once_set;
+
+        //! The mockers registered, and the nodes allocated, by a context between two snapshots. Once a snapshot
+        //! is taken the pool is frozen and the context starts a new one, so a node may be written in place only
+        //! while it belongs to the context's current pool.
+        struct pool : boost::noncopyable
+        {
+            pool()
+                : isFrozen(false)
+            {}
+
+            std::vector< boost::shared_ptr<mocker> >    mockers;
+            std::vector< std::unique_ptr<node> >        nodes;
+            bool                                        isFrozen;
+        };
+
+    public:
+
+        //! \class snapshot
+        //! \brief The registrations of a context at a point in time. A snapshot keeps the mockers it refers to
+        //! alive, so it may outlive the context it was taken from. Copying a snapshot is cheap.
+        class snapshot
+        {
+            friend class mock_context;
+
+        public:
+
+            snapshot()
+                : m_pRoot(0)
+            {}
+
+        private:
+
+            const node*                                 m_pRoot;
+            boost::shared_ptr<const once_set>           m_pEntered;
+            std::vector< boost::shared_ptr<pool> >      m_pools;
+        };
+
+        mock_context()
+            : m_pPool(boost::make_shared<pool>())
+            , m_pEntered(boost::make_shared<once_set>())
+        {
+            m_pools.push_back(m_pPool);
+        }
+
+        //! Starts with the registrations captured in s.
+        explicit mock_context(const snapshot& s)
+            : m_pPool(boost::make_shared<pool>())
+            , m_pEntered(boost::make_shared<once_set>())
+        {
+            m_pools.push_back(m_pPool);
+            restore(s);
+        }
+
+        void set_mocker(const mock_site& site, const boost::shared_ptr<mocker>& pMocker)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            //! Mockers are retained until the context and its snapshots are destroyed as mocks may still refer to them.
+            writable_pool().mockers.push_back(pMocker);
+            publish(site, pMocker.get());
+        }
+
+        //! Reinstates a mocker previously registered in this context for the site (or none).
+        void restore_mocker(const mock_site& site, mocker* pMocker)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            publish(site, pMocker);
+        }
+
+        //! Returns true the first time it is called for a given once block in this context.
+        bool enter_once(const void* pOnceBlock)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            if (m_pEntered->count(pOnceBlock))
+                return false;
+            //! The set may be shared with a snapshot.
+            if (!m_pEntered.unique())
+                m_pEntered = boost::make_shared<once_set>(*m_pEntered);
+            m_pEntered->insert(pOnceBlock);
+            return true;
+        }
+
+        //! Captures the registrations of the context. O(1) in the number of registrations.
+        snapshot get_snapshot() const
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            snapshot s;
+            s.m_pRoot = m_pRoot.load(std::memory_order_relaxed);
+            s.m_pEntered = m_pEntered;
+            s.m_pools = m_pools;
+            //! The nodes now shared with s must not change, so the next registration starts a new pool.
+            m_pPool->isFrozen = true;
+            return s;
+        }
+
+        //! Replaces the registrations of the context with those captured in s, which may have been taken from
+        //! another context. O(1) in the number of registrations. Mocks bind their mockers on first use, so no
+        //! mock constructed in the context may be alive across a restore.
+        void restore(const snapshot& s)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            for (std::size_t i = 0; i < s.m_pools.size(); ++i)
+                if (std::find(m_pools.begin(), m_pools.end(), s.m_pools[i]) == m_pools.end())
+                    m_pools.push_back(s.m_pools[i]);
+            m_pEntered = s.m_pEntered ? boost::const_pointer_cast<once_set>(s.m_pEntered) : boost::make_shared<once_set>();
+            //! The nodes of s belong to frozen pools, so they are copied rather than written. The superseded tree
+            //! stays in the context's pools as concurrent readers may still refer to it.
+            m_pRoot.store(s.m_pRoot, std::memory_order_release);
+        }
+
+    private:
+
+        //! Called with m_mutex held.
+        pool& writable_pool()
+        {
+            if (m_pPool->isFrozen)
+            {
+                m_pPool = boost::make_shared<pool>();
+                m_pools.push_back(m_pPool);
+            }
+            return *m_pPool;
+        }
+
+        //! Called with m_mutex held. Allocates a node in the current pool with pFirst in its first slot.
+        node* new_node(std::size_t level, void* pFirst)
+        {
+            pool& p = writable_pool();
+            p.nodes.push_back(std::unique_ptr<node>());
+            p.nodes.back().reset(new node(level, &p));
+            p.nodes.back()->slots[0].store(pFirst, std::memory_order_relaxed);
+            return p.nodes.back().get();
+        }
+
+        //! Called with m_mutex held. Returns pNode if the context may write it in place, and a copy otherwise.
+        node* own(const node* pNode)
+        {
+            if (pNode->pOwner == &writable_pool())
+                return const_cast<node*>(pNode);
+            node* pCopy = new_node(pNode->level, 0);
+            for (std::size_t i = 0; i <= node::mask; ++i)
+                pCopy->slots[i].store(pNode->slots[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return pCopy;
+        }
+
+        //! Called with m_mutex held. Nodes are only written once they are complete, and then with release
+        //! stores, so a concurrent reader sees the site's old or new mocker and every other slot unchanged.
+        void publish(const mock_site& site, mocker* pMocker)
+        {
+            std::size_t id = site.id();
+            const node* pRoot = m_pRoot.load(std::memory_order_relaxed);
+            if (!pRoot)
+                pRoot = new_node(0, 0);
+            while ((id >> node::bits >> (node::bits * pRoot->level)) != 0)
+                pRoot = new_node(pRoot->level + 1, const_cast<node*>(pRoot));
+
+            node* pOwnedRoot = own(pRoot);
+            node* pNode = pOwnedRoot;
+            for (std::size_t level = pNode->level; level; --level)
+            {
+                std::atomic<void*>& slot = pNode->slots[(id >> (node::bits * level)) & node::mask];
+                const node* pChild = static_cast<const node*>(slot.load(std::memory_order_relaxed));
+                node* pOwned = pChild ? own(pChild) : new_node(level - 1, 0);
+                if (pOwned != pChild)
+                    slot.store(pOwned, std::memory_order_release);
+                pNode = pOwned;
+            }
+            pNode->slots[id & node::mask].store(pMocker, std::memory_order_release);
+            m_pRoot.store(pOwnedRoot, std::memory_order_release);
+        }
+
+        mutable std::mutex                              m_mutex;
+        boost::shared_ptr<pool>                         m_pPool;
+        std::vector< boost::shared_ptr<pool> >          m_pools;
+        boost::shared_ptr<once_set>                     m_pEntered;
+    };
+
+    namespace detail
+    {
+        //! The context bound to the calling thread, or null for the process wide registry.
+        inline mock_context* current_mock_context()
+        {
+            return static_cast<mock_context*>(current_context());
+        }
+
+        //! Registers a mocker in the calling thread's context.
+        inline void set_mocker(mock_site& site, const boost::shared_ptr<mocker>& pMocker)
+        {
+            if (mock_context* pContext = current_mock_context())
+                pContext->set_mocker(site, pMocker);
+            else
+                mocker_registry::instance().set_mocker(site, pMocker);
+        }
+
+        //! Reinstates pMocker for the site in pContext, or in the process wide registry if pContext is null.
+        inline void restore_mocker(mock_site& site, mocker* pMocker, mock_context* pContext)
+        {
+            if (pContext)
+                pContext->restore_mocker(site, pMocker);
+            else
+                mocker_registry::instance().restore_mocker(site, pMocker);
+        }
+
+    }//! namespace detail;
+
+    //! \class scoped_mock_context
+    //! \brief Binds a mock_context to the calling thread for the lifetime of the object. Bindings nest.
+    class scoped_mock_context : boost::noncopyable
+    {
+    public:
+
+        explicit scoped_mock_context(mock_context& context)
+            : m_pPrevious(detail::current_context())
+        {
+            detail::current_context() = &context;
+        }
+
+        ~scoped_mock_context()
+        {
+            detail::current_context() = m_pPrevious;
+        }
+
+    private:
+
+        detail::context_dispatch* m_pPrevious;
+    };
+
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_MOCKCONTEXT_HPP
@@ -0,0 +1,155 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKFNCACHE_HPP
+#define NVM_DETAIL_MOCKFNCACHE_HPP
+#pragma once
+
+#include "mock_context.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace nvm { namespace detail {
+
+    //! \class mock_fn_cache
+    //! \brief Per mock instance map from mock_site::id() to bound mock callables.
+    //! An entry is created the first time a site is called through the owning mock and reused
+    //! until a different mocker is registered for that site (sites retain every mocker registered
+    //! with them, so comparing mocker addresses detects a re-registration). The map is a small open
+    //! addressed table, sized by the sites actually called rather than by the largest site id, so lookups
+    //! are lock-free loads along a short probe and only misses take the lock. Entries are added and replaced
+    //! in place; the table is only copied when it doubles. Superseded tables and entries are freed with the
+    //! mock, as concurrent callers may still hold them. The superseded tables are together smaller than the
+    //! current one.
+    class mock_fn_cache
+    {
+        struct entry
+        {
+            entry(std::size_t siteId, const mocker* pMocker, const boost::shared_ptr<mock_function_base>& pFn)
+                : siteId(siteId)
+                , pMocker(pMocker)
+                , pFn(pFn)
+            {}
+
+            std::size_t                             siteId;
+            const mocker*                           pMocker;
+            boost::shared_ptr<mock_function_base>   pFn;
+        };
+
+        typedef std::atomic<const entry*> entry_slot;
+
+        //! Linear probing from the site id. A table is never more than half full, so a probe always reaches
+        //! an empty slot.
+        struct table
+        {
+            explicit table(std::size_t capacity)
+                : mask(capacity - 1)
+                , pSlots(new entry_slot[capacity])
+            {
+                for (std::size_t i = 0; i < capacity; ++i)
+                    pSlots[i].store(0, std::memory_order_relaxed);
+            }
+
+            std::size_t capacity() const { return mask + 1; }
+
+            //! The slot holding the entry for id, or the empty slot which would.
+            entry_slot& get_slot(std::size_t id) const
+            {
+                for (std::size_t i = id & mask;; i = (i + 1) & mask)
+                {
+                    const entry* pEntry = pSlots[i].load(std::memory_order_acquire);
+                    if (!pEntry || pEntry->siteId == id)
+                        return pSlots[i];
+                }
+            }
+
+            std::size_t                     mask;
+            std::unique_ptr<entry_slot[]>   pSlots;
+        };
+
+    public:
+
+        mock_fn_cache()
+            : m_table(0)
+            , m_size(0)
+        {}
+
+        //! The cache only holds data derived from the owning instance, so copies start empty.
+        mock_fn_cache(const mock_fn_cache&)
+            : m_table(0)
+            , m_size(0)
+        {}
+
+        mock_fn_cache& operator =(const mock_fn_cache&)
+        {
+            return *this;
+        }
+
+        //! \param pContext is the context the owning mock was constructed in (null for the process wide registry).
+        const mock_function_base* get(const mock_site& site, void* pThis, const context_dispatch* pContext)
+        {
+            const mocker* pMocker = detail::get_mocker(site, pContext);
+            if (!pMocker)
+                return 0;
+
+            if (const table* pTable = m_table.load(std::memory_order_acquire))
+            {
+                const entry* pEntry = pTable->get_slot(site.id()).load(std::memory_order_acquire);
+                if (pEntry && pEntry->pMocker == pMocker)
+                    return pEntry->pFn.get();
+            }
+
+            return insert(site.id(), pMocker, pThis);
+        }
+
+    private:
+
+        const mock_function_base* insert(std::size_t id, const mocker* pMocker, void* pThis)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+
+            //! Another thread may have filled the entry while this one waited.
+            const table* pTable = m_table.load(std::memory_order_relaxed);
+            const entry* pEntry = pTable ? pTable->get_slot(id).load(std::memory_order_relaxed) : 0;
+            if (pEntry && pEntry->pMocker == pMocker)
+                return pEntry->pFn.get();
+
+            boost::shared_ptr<entry> pNewEntry = boost::make_shared<entry>(id, pMocker, (*pMocker)(pThis));
+            m_entries.push_back(pNewEntry);
+            if (pEntry || (pTable && 2 * (m_size + 1) <= pTable->capacity()))
+                pTable->get_slot(id).store(pNewEntry.get(), std::memory_order_release);
+            else
+            {
+                std::unique_ptr<table> pNewTable(new table(pTable ? 2 * pTable->capacity() : 8));
+                for (std::size_t i = 0; pTable && i < pTable->capacity(); ++i)
+                {
+                    if (const entry* pOld = pTable->pSlots[i].load(std::memory_order_relaxed))
+                        pNewTable->get_slot(pOld->siteId).store(pOld, std::memory_order_relaxed);
+                }
+                pNewTable->get_slot(id).store(pNewEntry.get(), std::memory_order_relaxed);
+                m_tables.push_back(std::move(pNewTable));
+                m_table.store(m_tables.back().get(), std::memory_order_release);
+            }
+            if (!pEntry)
+                ++m_size;
+            return pNewEntry->pFn.get();
+        }
+
+        std::atomic<const table*>               m_table;
+        std::size_t                             m_size;
+        std::mutex                              m_mutex;
+        std::vector< boost::shared_ptr<entry> > m_entries;
+        std::vector< std::unique_ptr<table> >   m_tables;
+    };
+
+}}//! namespace nvm::detail;
+
+#endif // NVM_DETAIL_MOCKFNCACHE_HPP
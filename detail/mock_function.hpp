@@ -0,0 +1,213 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKFUNCTION_HPP
+#define NVM_DETAIL_MOCKFUNCTION_HPP
+#pragma once
+
+#include "config.hpp"
+#include "mock_site.hpp"
+#include <boost/assert.hpp>
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#else
+#include <boost/function.hpp>
+#endif
+
+//! \def NVM_MOCK_FUNCTION_BUFFER_SIZE
+//! \brief The size of the inline buffer in which mock_function stores its callable. A callable bound by a mock
+//! (a member function pointer and the mock instance) always fits; larger callables are stored on the heap.
+#if !defined(NVM_MOCK_FUNCTION_BUFFER_SIZE)
+    #define NVM_MOCK_FUNCTION_BUFFER_SIZE (6 * sizeof(void*))
+#endif
+
+namespace nvm
+{
+    namespace detail
+    {
+        //! The address of value identifies Signature within a module.
+        template <typename Signature>
+        struct signature_tag
+        {
+            static const char value;
+        };
+
+        template <typename Signature>
+        const char signature_tag<Signature>::value = 0;
+    }//! namespace detail;
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+    //! \class mock_function
+    //! \brief The callable for one signature that a mock binds and an intercept site invokes.
+    //! The callable is stored in an inline buffer when it fits, so binding a mock member function does not
+    //! allocate beyond the mock_function itself, and a call is a single indirect call through a function
+    //! pointer which invokes the stored callable directly. As with std::function, the stored callable is
+    //! invoked as non-const.
+    template <typename Signature>
+    class mock_function;
+
+    template <typename R, typename... Params>
+    class mock_function<R(Params...)>
+        : public mock_function_base
+        , boost::noncopyable
+    {
+        typedef typename std::aligned_storage<NVM_MOCK_FUNCTION_BUFFER_SIZE, alignof(std::max_align_t)>::type storage_type;
+
+        template <typename F>
+        struct is_inline
+            : std::integral_constant
+              <
+                  bool
+                , sizeof(F) <= sizeof(storage_type) && alignof(storage_type) % alignof(F) == 0
+              >
+        {};
+
+    public:
+
+        template <typename F>
+        explicit mock_function(F f)
+            : mock_function_base(&detail::signature_tag<R(Params...)>::value)
+        {
+            construct(std::move(f), is_inline<F>());
+        }
+
+        ~mock_function()
+        {
+            m_destroy(&m_storage);
+        }
+
+        R operator()(Params... args) const
+        {
+            return m_invoke(const_cast<storage_type*>(&m_storage), std::forward<Params>(args)...);
+        }
+
+    private:
+
+        template <typename F>
+        void construct(F&& f, std::true_type)
+        {
+            ::new (static_cast<void*>(&m_storage)) F(std::move(f));
+            m_invoke = &invoke_inline<F>;
+            m_destroy = &destroy_inline<F>;
+        }
+
+        template <typename F>
+        void construct(F&& f, std::false_type)
+        {
+            ::new (static_cast<void*>(&m_storage)) F*(new F(std::move(f)));
+            m_invoke = &invoke_heap<F>;
+            m_destroy = &destroy_heap<F>;
+        }
+
+        template <typename F>
+        static R invoke_inline(void* pStorage, Params&&... args)
+        {
+            return (*static_cast<F*>(pStorage))(std::forward<Params>(args)...);
+        }
+
+        template <typename F>
+        static R invoke_heap(void* pStorage, Params&&... args)
+        {
+            return (**static_cast<F**>(pStorage))(std::forward<Params>(args)...);
+        }
+
+        template <typename F>
+        static void destroy_inline(void* pStorage)
+        {
+            static_cast<F*>(pStorage)->~F();
+        }
+
+        template <typename F>
+        static void destroy_heap(void* pStorage)
+        {
+            delete *static_cast<F**>(pStorage);
+        }
+
+        R            (*m_invoke)(void*, Params&&...);
+        void         (*m_destroy)(void*);
+        storage_type m_storage;
+    };
+#else
+    //! \class mock_function
+    //! \brief The callable for one signature that a mock binds and an intercept site invokes.
+    //! Without variadic templates this wraps boost::function.
+    template <typename Signature>
+    struct mock_function
+        : mock_function_base
+        , boost::function<Signature>
+    {
+        typedef boost::function<Signature> function_type;
+
+        template <typename F>
+        explicit mock_function(F f)
+            : mock_function_base(&detail::signature_tag<Signature>::value)
+            , function_type(f)
+        {}
+    };
+#endif
+
+    namespace detail
+    {
+        //! Casts the type erased callable handed out by a mock or scoped_override back to the signature of the
+        //! intercept. The signature is part of the site key so the types always agree unless an intercept
+        //! declares a signature (NVM_MOCK_INTERCEPT_SIG) which differs from the member function's; debug
+        //! builds check for that. The tag comparison settles the common case; callables created in another module
+        //! carry that module's tag and fall back to dynamic_cast.
+        template <typename Signature>
+        inline const mock_function<Signature>* mock_function_cast(const mock_function_base* pFn)
+        {
+            BOOST_ASSERT_MSG(!pFn || pFn->signature() == &signature_tag<Signature>::value || dynamic_cast<const mock_function<Signature>*>(pFn), "mock_function signature does not match the intercept.");
+            return static_cast<const mock_function<Signature>*>(pFn);
+        }
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+        //! Invokes a mock_function with the parameters of the intercepted member function.
+        //! Each argument is cast to the declared parameter type of the signature, so by-value
+        //! parameters are moved (the intercept returns immediately after the call) and reference
+        //! parameters are passed through untouched. This supports move-only parameter types and
+        //! avoids copying large by-value arguments on their way to the mock.
+        template <typename Signature>
+        struct forwarding_call;
+
+        template <typename R, typename... Params>
+        struct forwarding_call<R(Params...)>
+        {
+            explicit forwarding_call(const mock_function<R(Params...)>& fn)
+                : fn(fn)
+            {}
+
+            template <typename... Args>
+            R operator()(Args&&... args) const
+            {
+                return fn(static_cast<Params&&>(args)...);
+            }
+
+            const mock_function<R(Params...)>& fn;
+        };
+
+        template <typename Signature>
+        inline forwarding_call<Signature> make_forwarding_call(const mock_function<Signature>& fn)
+        {
+            return forwarding_call<Signature>(fn);
+        }
+#else
+        //! Without variadic templates the arguments are passed as named by the intercept.
+        template <typename Signature>
+        inline const mock_function<Signature>& make_forwarding_call(const mock_function<Signature>& fn)
+        {
+            return fn;
+        }
+#endif
+    }//! namespace detail;
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_MOCKFUNCTION_HPP
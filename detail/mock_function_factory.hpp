@@ -10,7 +10,11 @@
 #define NVM_MAX_BIND_PLACEHOLDERS 10
 #endif
 
-#if !defined(NVM_DONT_USE_PREPROCESSED_FILES)
+#include "config.hpp"
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+#include "variadic/mock_function_factory.hpp"
+#elif !defined(NVM_DONT_USE_PREPROCESSED_FILES)
 #include "preprocessed/mock_function_factory.hpp"
 #else
 
@@ -60,10 +64,10 @@ template <>
 struct mock_function_factory<n>                                                                      \
 {                                                                                                    \
     template <typename OriginalMFN, typename MockMFN, typename T>                                    \
-    static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis)\
+    static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis)\
     {                                                                                                \
         typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type;                            \
-        boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> > \
+        boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> > \
         (boost::bind(mpMFN, pThis BOOST_PP_COMMA_IF(BOOST_PP_DEC(n)) NVM_ENUM_BIND_ARGS(BOOST_PP_DEC(n)))); \
         return pFn;                                                                                  \
     }                                                                                                \
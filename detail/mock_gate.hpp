@@ -0,0 +1,51 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKGATE_HPP
+#define NVM_DETAIL_MOCKGATE_HPP
+#pragma once
+
+#include "config.hpp"
+#include <atomic>
+#include <cstddef>
+
+namespace nvm
+{
+    namespace detail
+    {
+#if defined(NVM_SHARED_REGISTRY)
+        //! Defined in src/registry.cpp. The counter is exported as data rather than through a function so that
+        //! the gate stays a single load (through the GOT/import table) rather than a call into another module.
+        NVM_REGISTRY_DECL extern std::atomic<std::size_t> shared_live_mock_count;
+
+        inline std::atomic<std::size_t>& live_mock_count()
+        {
+            return shared_live_mock_count;
+        }
+#else
+        //! The number of nvm::mock instances currently alive in the process.
+        //! The counter is constant initialized so reading it does not pay for a static guard.
+        inline std::atomic<std::size_t>& live_mock_count()
+        {
+            static std::atomic<std::size_t> s_count(0);
+            return s_count;
+        }
+#endif
+    }//! namespace detail;
+
+    //! \brief Returns true if any mock is alive in the process.
+    //! This is the fast path check at every intercept site. When it is false no intercepted call can be mocked
+    //! and the site proceeds straight to the real implementation.
+    inline bool any_mock_alive()
+    {
+        return detail::live_mock_count().load(std::memory_order_relaxed) != 0;
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_MOCKGATE_HPP
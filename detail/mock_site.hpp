@@ -0,0 +1,337 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKSITE_HPP
+#define NVM_DETAIL_MOCKSITE_HPP
+#pragma once
+
+//! The part of the registry which intercept sites need: site lookup by key. This is included by every
+//! translation unit with an intercept so it depends on nothing beyond the standard library and Boost.Config.
+#include "config.hpp"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Declared rather than included so that intercept sites do not pay for Boost.SmartPtr.
+namespace boost { template <class T> class shared_ptr; }
+
+namespace nvm
+{
+    //! \class mock_function_base
+    //! \brief Type erased base of the callables which a mock hands to an intercept site.
+    //! The intercept knows the signature and casts back to mock_function<Signature>. signature() identifies
+    //! the signature within a module so that the cast can be checked cheaply in debug builds.
+    struct mock_function_base
+    {
+        explicit mock_function_base(const void* pSignature = 0)
+            : m_pSignature(pSignature)
+        {}
+
+        virtual ~mock_function_base(){}
+
+        const void* signature() const { return m_pSignature; }
+
+    private:
+
+        const void* m_pSignature;
+    };
+
+    //! \class mocker
+    //! \brief Creates the mocked callable for a registered member function given the mock instance.
+    //! Mockers of free and static member functions are not bound to an object; get_function returns their callable.
+    struct mocker
+    {
+        virtual ~mocker(){}
+        virtual boost::shared_ptr<mock_function_base> operator()(void* pThis) const = 0;
+        virtual const mock_function_base* get_function() const { return 0; }
+    };
+
+    namespace detail { class mocker_registry; }
+
+    //! \class mock_site
+    //! \brief The registry entry for one mockable member function.
+    //! Intercept sites resolve their mock_site once (on first use) and keep a reference to it
+    //! so that subsequent calls do not need to build a key or search the registry.
+    //! Reading the registered mocker is a single acquire load. Mockers which are replaced are
+    //! retained by the mocker_registry so that a concurrent reader never sees a dangling mocker.
+    //! A site has two mockers: the one registered at run time (NVM_REGISTER_MOCK_* in the process wide
+    //! registry) and the one loaded from a mock table (see mock_table.hpp), which applies in every
+    //! mock_context unless a run time registration shadows it.
+    class mock_site
+    {
+        friend class detail::mocker_registry;
+
+    public:
+
+        mock_site(const std::string& key, const std::string& name, std::size_t id)
+            : m_key(key)
+            , m_name(name)
+            , m_id(id)
+            , m_pMocker(0)
+            , m_pTableMocker(0)
+        {}
+
+        const std::string& key() const { return m_key; }
+        const std::string& name() const { return m_name; }
+        std::size_t        id() const { return m_id; }
+
+        mocker* get_mocker() const { return m_pMocker.load(std::memory_order_acquire); }
+        mocker* get_table_mocker() const { return m_pTableMocker.load(std::memory_order_acquire); }
+
+    private:
+
+        std::string          m_key;
+        std::string          m_name;
+        std::size_t          m_id;
+        std::atomic<mocker*> m_pMocker;
+        std::atomic<mocker*> m_pTableMocker;
+    };
+
+    namespace detail
+    {
+        //! \class context_dispatch
+        //! \brief The part of a mock_context which intercept sites read: its mockers indexed by mock_site::id().
+        //! The mockers are held in a radix tree over the id with 64 slots per node, so a registration writes one
+        //! slot rather than copying a table. Interior slots point at the nodes of the level below and leaf slots at
+        //! mockers; every slot is read with an acquire load.
+        class context_dispatch
+        {
+        public:
+
+            mocker* get_mocker(const mock_site& site) const
+            {
+                const node* pNode = m_pRoot.load(std::memory_order_acquire);
+                std::size_t id = site.id();
+                if (!pNode || (id >> node::bits >> (node::bits * pNode->level)) != 0)
+                    return 0;
+                for (std::size_t level = pNode->level; pNode && level; --level)
+                    pNode = static_cast<const node*>(pNode->slots[(id >> (node::bits * level)) & node::mask].load(std::memory_order_acquire));
+                return pNode ? static_cast<mocker*>(pNode->slots[id & node::mask].load(std::memory_order_acquire)) : 0;
+            }
+
+        protected:
+
+            struct node
+            {
+                static const std::size_t bits = 6;
+                static const std::size_t mask = (std::size_t(1) << bits) - 1;
+
+                //! \param pOwner identifies the allocation which may write the node in place (see mock_context).
+                node(std::size_t level, const void* pOwner)
+                    : level(level)
+                    , pOwner(pOwner)
+                {
+                    for (std::size_t i = 0; i <= mask; ++i)
+                        slots[i].store(0, std::memory_order_relaxed);
+                }
+
+                std::size_t         level;
+                const void*         pOwner;
+                std::atomic<void*>  slots[mask + 1];
+            };
+
+            context_dispatch()
+                : m_pRoot(0)
+            {}
+
+            ~context_dispatch(){}
+
+            std::atomic<const node*> m_pRoot;
+        };
+
+#if defined(NVM_SHARED_REGISTRY)
+        //! Defined in src/registry.cpp.
+        NVM_REGISTRY_DECL context_dispatch*& current_context();
+#else
+        //! The mock_context bound to the calling thread, or null for the process wide registry.
+        inline context_dispatch*& current_context()
+        {
+            static thread_local context_dispatch* t_pContext = 0;
+            return t_pContext;
+        }
+#endif
+
+        //! The mocker registered for a site in a context, or in the process wide registry if pContext is null.
+        //! Either shadows the site's mock table entry.
+        inline mocker* get_mocker(const mock_site& site, const context_dispatch* pContext)
+        {
+            mocker* pMocker = pContext ? pContext->get_mocker(site) : site.get_mocker();
+            return pMocker ? pMocker : site.get_table_mocker();
+        }
+
+    }//! namespace detail;
+
+    namespace detail
+    {
+        //! \class site_registry
+        //! \brief Owns the mock_site entries keyed by member function name and type.
+        //! Sites are never removed so references handed out by get_site remain valid for the lifetime of the process.
+        //! The keys are indexed by an open addressed hash table whose slots are written once, so readers probe the
+        //! current index without locking while writers serialize on a mutex and add to it in place. An index at
+        //! half load is replaced by one of twice the capacity; superseded indexes are freed by a later writer once
+        //! it observes that no reader is inside a lookup.
+        class site_registry
+        {
+            struct site_index
+            {
+                explicit site_index(std::size_t capacity)
+                    : mask(capacity - 1)
+                    , pSlots(new std::atomic<mock_site*>[capacity])
+                {
+                    for (std::size_t i = 0; i < capacity; ++i)
+                        pSlots[i].store(0, std::memory_order_relaxed);
+                }
+
+                std::size_t capacity() const { return mask + 1; }
+
+                std::size_t                                 mask;
+                std::unique_ptr<std::atomic<mock_site*>[]>  pSlots;
+            };
+
+        public:
+
+            site_registry()
+                : m_pIndex(0)
+                , m_readers(0)
+            {}
+
+            ~site_registry()
+            {
+                release(m_retired);
+                delete m_pIndex.load();
+                for (std::size_t i = 0; i < m_siteStore.size(); ++i)
+                    delete m_siteStore[i];
+            }
+
+#if defined(NVM_SHARED_REGISTRY)
+            //! Defined in src/registry.cpp so that every module in the process shares one instance.
+            NVM_REGISTRY_DECL static site_registry& instance();
+#else
+            //! Each module (executable or shared library) gets its own instance. Define NVM_SHARED_REGISTRY
+            //! when mocks must reach intercept sites in other modules.
+            static site_registry& instance()
+            {
+                static site_registry s_instance;
+                return s_instance;
+            }
+#endif
+
+            //! \param name is the human readable member function name used in diagnostics.
+            mock_site& get_site(const std::string& key, const std::string& name)
+            {
+                m_readers.fetch_add(1);
+                mock_site* pFound = find_site(m_pIndex.load(), key);
+                m_readers.fetch_sub(1);
+                if (pFound)
+                    return *pFound;
+
+                std::lock_guard<std::mutex> lk(m_mutex);
+                if (mock_site* pSite = find_site(m_pIndex.load(std::memory_order_relaxed), key))
+                    return *pSite;
+                return *create_site(key, name);
+            }
+
+            //! Looks up (or creates) the sites for every (key, name) pair in entries under one lock.
+            void get_sites(const std::vector< std::pair<std::string, std::string> >& entries, std::vector<mock_site*>& sites)
+            {
+                sites.resize(entries.size());
+                std::lock_guard<std::mutex> lk(m_mutex);
+                for (std::size_t i = 0; i < entries.size(); ++i)
+                {
+                    if ((sites[i] = find_site(m_pIndex.load(std::memory_order_relaxed), entries[i].first)) == 0)
+                        sites[i] = create_site(entries[i].first, entries[i].second);
+                }
+            }
+
+            //! Look up a site by its id. Returns null if no such site has been created.
+            const mock_site* get_site_by_id(std::size_t id)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                return id < m_siteStore.size() ? m_siteStore[id] : 0;
+            }
+
+        private:
+
+            //! Called with m_mutex held.
+            mock_site* create_site(const std::string& key, const std::string& name)
+            {
+                //! Owned until it is in m_siteStore, in case growing m_siteStore throws.
+                std::unique_ptr<mock_site> pSite(new mock_site(key, name, m_siteStore.size()));
+                m_siteStore.push_back(pSite.get());
+
+                const site_index* pIndex = m_pIndex.load(std::memory_order_relaxed);
+                if (pIndex && 2 * m_siteStore.size() <= pIndex->capacity())
+                    insert(*pIndex, pSite.get());
+                else
+                {
+                    std::unique_ptr<site_index> pNewIndex(new site_index(pIndex ? 2 * pIndex->capacity() : 64));
+                    for (std::size_t i = 0; i < m_siteStore.size(); ++i)
+                        insert(*pNewIndex, m_siteStore[i]);
+                    publish(pNewIndex);
+                }
+                return pSite.release();
+            }
+
+            //! Called with m_mutex held.
+            static void insert(const site_index& index, mock_site* pSite)
+            {
+                std::size_t i = std::hash<std::string>()(pSite->key()) & index.mask;
+                while (index.pSlots[i].load(std::memory_order_relaxed))
+                    i = (i + 1) & index.mask;
+                index.pSlots[i].store(pSite, std::memory_order_release);
+            }
+
+            //! Called with m_mutex held.
+            void publish(std::unique_ptr<site_index>& pIndex)
+            {
+                if (const site_index* pCurrent = m_pIndex.load(std::memory_order_relaxed))
+                    m_retired.push_back(pCurrent);
+                m_pIndex.store(pIndex.release());
+
+                //! Readers which start after the store see the new index, so once no reader is
+                //! in flight nobody can hold a pointer into a retired one.
+                if (m_readers.load() == 0)
+                    release(m_retired);
+            }
+
+            static void release(std::vector<const site_index*>& retired)
+            {
+                for (std::size_t i = 0; i < retired.size(); ++i)
+                    delete retired[i];
+                retired.clear();
+            }
+
+            //! The index is never more than half full, so a probe always reaches an empty slot.
+            static mock_site* find_site(const site_index* pIndex, const std::string& key)
+            {
+                if (!pIndex)
+                    return 0;
+                for (std::size_t i = std::hash<std::string>()(key) & pIndex->mask;; i = (i + 1) & pIndex->mask)
+                {
+                    mock_site* pSite = pIndex->pSlots[i].load(std::memory_order_acquire);
+                    if (!pSite || pSite->key() == key)
+                        return pSite;
+                }
+            }
+
+            std::atomic<const site_index*>  m_pIndex;
+            std::atomic<int>                m_readers;
+            std::mutex                      m_mutex;
+            std::vector<const site_index*>  m_retired;
+            std::vector<mock_site*>         m_siteStore;
+        };
+
+    }//! namespace detail;
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_MOCKSITE_HPP
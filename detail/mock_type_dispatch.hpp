@@ -0,0 +1,357 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKTYPEDISPATCH_HPP
+#define NVM_DETAIL_MOCKTYPEDISPATCH_HPP
+#pragma once
+
+#include "config.hpp"
+#include "mock_site.hpp"
+#include "mock_context.hpp"
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace nvm
+{
+    struct mock_base;
+
+    namespace detail
+    {
+        //! A table of sites indexed by the mock_site::id() of the original member function. Entries are written in
+        //! place into segments which double in size (as in site_stats_shard), so reading is a lock-free load of the
+        //! segment and of the entry, and adding entries never copies the table.
+        class site_table : boost::noncopyable
+        {
+            typedef std::atomic<mock_site*> site_slot;
+
+            static const std::size_t first_sites = 64;
+            static const std::size_t segment_count = 48;
+
+            //! Segment 0 holds ids [0, first_sites) and segment k > 0 holds [first_sites << (k - 1), first_sites << k).
+            static std::size_t segment_base(std::size_t k) { return k ? first_sites << (k - 1) : 0; }
+            static std::size_t segment_size(std::size_t k) { return k ? first_sites << (k - 1) : first_sites; }
+
+            static std::size_t segment_of(std::size_t id)
+            {
+                std::size_t k = 0;
+                if (id >= first_sites)
+                    for (k = 1; id >= segment_base(k + 1); ++k);
+                return k;
+            }
+
+        public:
+
+            site_table()
+                : m_isEmpty(true)
+            {
+                for (std::size_t k = 0; k < segment_count; ++k)
+                    m_segments[k].store(0, std::memory_order_relaxed);
+            }
+
+            ~site_table()
+            {
+                for (std::size_t k = 0; k < segment_count; ++k)
+                    delete [] m_segments[k].load(std::memory_order_relaxed);
+            }
+
+            bool empty() const { return m_isEmpty.load(std::memory_order_acquire); }
+
+            mock_site* find_site(const mock_site& site) const
+            {
+                std::size_t k = segment_of(site.id());
+                const site_slot* pSegment = m_segments[k].load(std::memory_order_acquire);
+                return pSegment ? pSegment[site.id() - segment_base(k)].load(std::memory_order_acquire) : 0;
+            }
+
+        protected:
+
+            //! Called with the owner's lock held. Sets the entry of ids[i] to sites[i], a later entry for the same id
+            //! winning. The winners are found before any entry is written, so a concurrent reader only ever sees an
+            //! entry's previous site or its final one.
+            void publish(const std::vector<std::size_t>& ids, const std::vector<mock_site*>& sites)
+            {
+                std::vector< std::pair<std::size_t, std::size_t> > order;
+                order.reserve(ids.size());
+                for (std::size_t i = 0; i < ids.size(); ++i)
+                    order.push_back(std::make_pair(ids[i], i));
+                std::sort(order.begin(), order.end());
+                for (std::size_t i = 0; i < order.size(); ++i)
+                {
+                    if (i + 1 == order.size() || order[i + 1].first != order[i].first)
+                        get_slot(order[i].first).store(sites[order[i].second], std::memory_order_release);
+                }
+                if (!order.empty())
+                    m_isEmpty.store(false, std::memory_order_release);
+            }
+
+            //! Called with the owner's lock held.
+            void append_entries(std::vector<std::size_t>& ids, std::vector<mock_site*>& sites) const
+            {
+                for (std::size_t k = 0; k < segment_count; ++k)
+                {
+                    const site_slot* pSegment = m_segments[k].load(std::memory_order_relaxed);
+                    for (std::size_t i = 0; pSegment && i < segment_size(k); ++i)
+                    {
+                        if (mock_site* pSite = pSegment[i].load(std::memory_order_relaxed))
+                        {
+                            ids.push_back(segment_base(k) + i);
+                            sites.push_back(pSite);
+                        }
+                    }
+                }
+            }
+
+        private:
+
+            //! Called with the owner's lock held.
+            site_slot& get_slot(std::size_t id)
+            {
+                std::size_t k = segment_of(id);
+                site_slot* pSegment = m_segments[k].load(std::memory_order_relaxed);
+                if (!pSegment)
+                {
+                    pSegment = new site_slot[segment_size(k)];
+                    for (std::size_t i = 0; i < segment_size(k); ++i)
+                        pSegment[i].store(0, std::memory_order_relaxed);
+                    m_segments[k].store(pSegment, std::memory_order_release);
+                }
+                return pSegment[id - segment_base(k)];
+            }
+
+            std::atomic<site_slot*> m_segments[segment_count];
+            std::atomic<bool>       m_isEmpty;
+        };
+
+        //! \class mock_type_dispatch
+        //! \brief The mockers registered by one mock type.
+        //! A mock type registers its mockers under sites of its own (the original key qualified by the type name)
+        //! rather than under the original site, so mocks of different types for the same member function coexist.
+        //! The typed sites are ordinary sites, so contexts, mock tables and snapshots apply to them unchanged.
+        class mock_type_dispatch : public site_table
+        {
+            friend class mock_type_registry;
+
+        public:
+
+            typedef bool (*instance_check)(const mock_base*);
+
+            mock_type_dispatch(const std::string& typeName, instance_check isInstance, std::size_t order, std::atomic<std::size_t>& generation)
+                : m_typeName(typeName)
+                , m_isInstance(isInstance)
+                , m_order(order)
+                , m_generation(generation)
+            {}
+
+            //! Looks up (or creates) the type's site for an original site.
+            mock_site& get_site(const mock_site& site)
+            {
+                if (mock_site* pSite = find_site(site))
+                    return *pSite;
+                std::vector<mock_site*> originals(1, const_cast<mock_site*>(&site));
+                std::vector<mock_site*> sites;
+                get_sites(originals, sites);
+                return *sites[0];
+            }
+
+            //! Looks up (or creates) the type's sites for a batch of original sites with one registry update.
+            void get_sites(const std::vector<mock_site*>& originals, std::vector<mock_site*>& sites)
+            {
+                typedef std::pair<std::string, std::string> key_name;
+                std::vector< std::pair<key_name, std::size_t> > keys;
+                for (std::size_t i = 0; i < originals.size(); ++i)
+                    keys.push_back(std::make_pair(key_name(originals[i]->key() + '@' + m_typeName, originals[i]->name()), i));
+                std::sort(keys.begin(), keys.end());
+
+                std::vector<key_name> sorted;
+                for (std::size_t i = 0; i < keys.size(); ++i)
+                    sorted.push_back(keys[i].first);
+                std::vector<mock_site*> found;
+                site_registry::instance().get_sites(sorted, found);
+                sites.resize(originals.size());
+                for (std::size_t i = 0; i < keys.size(); ++i)
+                    sites[keys[i].second] = found[i];
+
+                std::vector<std::size_t> ids;
+                for (std::size_t i = 0; i < originals.size(); ++i)
+                    ids.push_back(originals[i]->id());
+                std::lock_guard<std::mutex> lk(m_mutex);
+                publish(ids, sites);
+                //! Effective tables built before this registration are updated on their next miss.
+                m_generation.fetch_add(1, std::memory_order_release);
+            }
+
+        private:
+
+            std::string                 m_typeName;
+            instance_check              m_isInstance;
+            std::size_t                 m_order;
+            std::atomic<std::size_t>&   m_generation;
+            std::mutex                  m_mutex;
+        };
+
+        //! \class mock_type_table
+        //! \brief The dispatch table of the instances of one dynamic mock type: the sites of every registering mock
+        //! type the instance is (its own and those of the mock types it derives from), a more derived type's
+        //! entry winning. It is built on the first call through an instance and brought up to date on a miss only
+        //! when some mock type has registered since. Registrations are never removed, so an update only adds or
+        //! replaces entries.
+        class mock_type_table : public site_table
+        {
+            friend class mock_type_registry;
+
+        public:
+
+            mock_type_table()
+                : m_generation(~std::size_t(0))
+            {}
+
+        private:
+
+            std::atomic<std::size_t> m_generation;
+        };
+
+        //! \class mock_type_registry
+        //! \brief Owns the dispatch tables of every mock type, keyed by type name so that all modules agree.
+        //! Tables are also indexed by the address of their std::type_info in a copy on write map, so that an
+        //! instance resolves its table without a lock once the first instance of its type has done so.
+        class mock_type_registry : boost::noncopyable
+        {
+            typedef std::map<const std::type_info*, mock_type_table*> type_index;
+
+        public:
+
+            mock_type_registry()
+                : m_generation(0)
+                , m_pIndex(0)
+            {}
+
+            ~mock_type_registry()
+            {
+                for (std::size_t i = 0; i < m_indexes.size(); ++i)
+                    delete m_indexes[i];
+                for (std::map<std::string, mock_type_dispatch*>::iterator it = m_dispatch.begin(); it != m_dispatch.end(); ++it)
+                    delete it->second;
+                for (std::map<std::string, mock_type_table*>::iterator it = m_tables.begin(); it != m_tables.end(); ++it)
+                    delete it->second;
+            }
+
+#if defined(NVM_SHARED_REGISTRY)
+            //! Defined in src/registry.cpp.
+            NVM_REGISTRY_DECL static mock_type_registry& instance();
+#else
+            static mock_type_registry& instance()
+            {
+                static mock_type_registry s_instance;
+                return s_instance;
+            }
+#endif
+
+            //! The registrations of a mock type. Types are ordered by their first registration, which for a mock
+            //! type and the mock types it derives from is base first (base constructors run first).
+            mock_type_dispatch& get_dispatch(const std::type_info& type, mock_type_dispatch::instance_check isInstance)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                mock_type_dispatch*& pDispatch = m_dispatch[type.name()];
+                if (!pDispatch)
+                {
+                    pDispatch = new mock_type_dispatch(type.name(), isInstance, m_order.size(), m_generation);
+                    m_order.push_back(pDispatch);
+                }
+                return *pDispatch;
+            }
+
+            //! The dispatch table of a dynamic mock type. Instances resolve it once and keep it.
+            mock_type_table& get_table(const std::type_info& type)
+            {
+                if (const type_index* pIndex = m_pIndex.load(std::memory_order_acquire))
+                {
+                    type_index::const_iterator it = pIndex->find(&type);
+                    if (it != pIndex->end())
+                        return *it->second;
+                }
+
+                std::lock_guard<std::mutex> lk(m_mutex);
+                mock_type_table*& pTable = m_tables[type.name()];
+                if (!pTable)
+                    pTable = new mock_type_table;
+                const type_index* pIndex = m_pIndex.load(std::memory_order_relaxed);
+                type_index* pNewIndex = pIndex ? new type_index(*pIndex) : new type_index();
+                (*pNewIndex)[&type] = pTable;
+                m_indexes.push_back(pNewIndex);
+                m_pIndex.store(pNewIndex, std::memory_order_release);
+                return *pTable;
+            }
+
+            //! Updates table from the registering types which pMock is an instance of, if any type has registered
+            //! since it was last updated. \return true if the table was updated.
+            bool refresh(mock_type_table& table, const mock_base* pMock)
+            {
+                std::size_t generation = m_generation.load(std::memory_order_acquire);
+                if (table.m_generation.load(std::memory_order_acquire) == generation)
+                    return false;
+
+                std::lock_guard<std::mutex> lk(m_mutex);
+                std::vector<std::size_t> ids;
+                std::vector<mock_site*> sites;
+                for (std::size_t i = 0; i < m_order.size(); ++i)
+                {
+                    mock_type_dispatch& dispatch = *m_order[i];
+                    if (dispatch.empty() || !dispatch.m_isInstance(pMock))
+                        continue;
+                    std::lock_guard<std::mutex> dispatchLock(dispatch.m_mutex);
+                    dispatch.append_entries(ids, sites);
+                }
+                table.publish(ids, sites);
+                table.m_generation.store(generation, std::memory_order_release);
+                return true;
+            }
+
+        private:
+
+            std::mutex                                  m_mutex;
+            std::atomic<std::size_t>                    m_generation;
+            std::map<std::string, mock_type_dispatch*>  m_dispatch;
+            std::vector<mock_type_dispatch*>            m_order;
+            std::map<std::string, mock_type_table*>     m_tables;
+            std::atomic<const type_index*>              m_pIndex;
+            std::vector<const type_index*>              m_indexes;
+        };
+
+        template <typename MockType>
+        inline bool is_mock_instance(const mock_base* pMock)
+        {
+            return dynamic_cast<const MockType*>(pMock) != 0;
+        }
+
+        template <typename MockType>
+        inline mock_type_dispatch& get_mock_type_dispatch()
+        {
+            static mock_type_dispatch& s_dispatch = mock_type_registry::instance().get_dispatch(typeid(MockType), &is_mock_instance<MockType>);
+            return s_dispatch;
+        }
+
+        //! Registers a mocker of MockType for a site in the calling thread's context.
+        template <typename MockType>
+        inline void set_mock_type_mocker(mock_site& site, const boost::shared_ptr<mocker>& pMocker)
+        {
+            set_mocker(get_mock_type_dispatch<MockType>().get_site(site), pMocker);
+        }
+
+    }//! namespace detail;
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_MOCKTYPEDISPATCH_HPP
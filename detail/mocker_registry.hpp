@@ -0,0 +1,74 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_MOCKERREGISTRY_HPP
+#define NVM_DETAIL_MOCKERREGISTRY_HPP
+#pragma once
+
+#include "config.hpp"
+#include "mock_site.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <mutex>
+#include <vector>
+
+namespace nvm
+{
+    namespace detail
+    {
+        //! \class mocker_registry
+        //! \brief Publishes the process wide mocker of each mock_site.
+        //! Mockers which are replaced are retained so that a concurrent reader never sees a dangling mocker.
+        class mocker_registry
+        {
+        public:
+
+#if defined(NVM_SHARED_REGISTRY)
+            //! Defined in src/registry.cpp so that every module in the process shares one instance.
+            NVM_REGISTRY_DECL static mocker_registry& instance();
+#else
+            static mocker_registry& instance()
+            {
+                static mocker_registry s_instance;
+                return s_instance;
+            }
+#endif
+
+            void set_mocker(mock_site& site, const boost::shared_ptr<mocker>& pMocker)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_mockers.push_back(pMocker);
+                site.m_pMocker.store(pMocker.get(), std::memory_order_release);
+            }
+
+            //! Reinstates a mocker previously registered for the site (or none), e.g. when a function_mock ends.
+            void restore_mocker(mock_site& site, mocker* pMocker)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                site.m_pMocker.store(pMocker, std::memory_order_release);
+            }
+
+            //! Publishes the mockers of a mock table (see mock_table.hpp), mockers[i] for sites[i], under one lock.
+            void set_table_mockers(const std::vector<mock_site*>& sites, const std::vector< boost::shared_ptr<mocker> >& mockers)
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_mockers.insert(m_mockers.end(), mockers.begin(), mockers.end());
+                for (std::size_t i = 0; i < sites.size(); ++i)
+                    sites[i]->m_pTableMocker.store(mockers[i].get(), std::memory_order_release);
+            }
+
+        private:
+
+            std::mutex                               m_mutex;
+            std::vector< boost::shared_ptr<mocker> > m_mockers;
+        };
+
+    }//! namespace detail;
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_MOCKERREGISTRY_HPP
@@ -16,16 +16,16 @@
 namespace nvm {
     template <unsigned int Arity>
     struct mock_function_factory;
-        template <> struct mock_function_factory<1> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis )); return pFn; } };
-        template <> struct mock_function_factory<2> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>())); return pFn; } };
-        template <> struct mock_function_factory<3> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>())); return pFn; } };
-        template <> struct mock_function_factory<4> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>())); return pFn; } };
-        template <> struct mock_function_factory<5> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>())); return pFn; } };
-        template <> struct mock_function_factory<6> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>())); return pFn; } };
-        template <> struct mock_function_factory<7> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>())); return pFn; } };
-        template <> struct mock_function_factory<8> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>() , boost::arg<7>())); return pFn; } };
-        template <> struct mock_function_factory<9> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>() , boost::arg<7>() , boost::arg<8>())); return pFn; } };
-        template <> struct mock_function_factory<10> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<boost::function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<boost::function_base> pFn = boost::make_shared<boost::function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>() , boost::arg<7>() , boost::arg<8>() , boost::arg<9>())); return pFn; } };
+        template <> struct mock_function_factory<1> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis )); return pFn; } };
+        template <> struct mock_function_factory<2> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>())); return pFn; } };
+        template <> struct mock_function_factory<3> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>())); return pFn; } };
+        template <> struct mock_function_factory<4> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>())); return pFn; } };
+        template <> struct mock_function_factory<5> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>())); return pFn; } };
+        template <> struct mock_function_factory<6> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>())); return pFn; } };
+        template <> struct mock_function_factory<7> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>())); return pFn; } };
+        template <> struct mock_function_factory<8> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>() , boost::arg<7>())); return pFn; } };
+        template <> struct mock_function_factory<9> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>() , boost::arg<7>() , boost::arg<8>())); return pFn; } };
+        template <> struct mock_function_factory<10> { template <typename OriginalMFN, typename MockMFN, typename T> static boost::shared_ptr<mock_function_base> create(OriginalMFN opMFN, MockMFN mpMFN, T* pThis) { typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type; boost::shared_ptr<mock_function_base> pFn = boost::make_shared<mock_function<sig_type> >( boost::bind(mpMFN, pThis , boost::arg<1>() , boost::arg<2>() , boost::arg<3>() , boost::arg<4>() , boost::arg<5>() , boost::arg<6>() , boost::arg<7>() , boost::arg<8>() , boost::arg<9>())); return pFn; } };
     
     template <typename Signature>
     struct mem_fn_ptr_gen;
@@ -0,0 +1,277 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_SITESTATSSHARD_HPP
+#define NVM_DETAIL_SITESTATSSHARD_HPP
+#pragma once
+
+#include "config.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace nvm
+{
+    namespace detail
+    {
+        //! The ways in which the cold half of an intercept (find_mock_fn) can resolve a call.
+        enum lookup_outcome
+        {
+            lookup_real,    //! The object is not mocked; the real implementation runs.
+            lookup_mocked,  //! The call is redirected to a mock or a scoped_override.
+            lookup_miss     //! The object is mocked but no mocker is registered for the member function.
+        };
+
+        //! Totals for one site.
+        struct site_totals
+        {
+            site_totals()
+                : calls(0)
+                , mocked(0)
+                , misses(0)
+                , lookupNanoseconds(0)
+            {}
+
+            std::uint64_t calls;
+            std::uint64_t mocked;
+            std::uint64_t misses;
+            std::uint64_t lookupNanoseconds;
+        };
+
+        //! \class site_stats_shard
+        //! \brief The counters of one thread for every intercept site.
+        //! Only the owning thread writes, so an increment is a relaxed load and store rather than a locked
+        //! read-modify-write. Counters are allocated in blocks of block_size sites on first use so that a
+        //! reader can walk them concurrently without locking the owner out. Blocks are found through segments
+        //! which double in size, the first covering the first first_blocks blocks, so every site id is counted
+        //! however many sites there are (per mock type sites multiply them).
+        class site_stats_shard : boost::noncopyable
+        {
+            struct counters
+            {
+                counters()
+                    : calls(0)
+                    , mocked(0)
+                    , misses(0)
+                    , lookupNanoseconds(0)
+                {}
+
+                std::atomic<std::uint64_t> calls;
+                std::atomic<std::uint64_t> mocked;
+                std::atomic<std::uint64_t> misses;
+                std::atomic<std::uint64_t> lookupNanoseconds;
+            };
+
+            typedef std::atomic<counters*> block_slot;
+
+            static const std::size_t block_size = 64;
+            static const std::size_t first_blocks = 64;
+            static const std::size_t segment_count = 48;
+
+            //! Segment 0 holds blocks [0, first_blocks) and segment k > 0 holds [first_blocks << (k - 1), first_blocks << k).
+            static std::size_t segment_base(std::size_t k) { return k ? first_blocks << (k - 1) : 0; }
+            static std::size_t segment_size(std::size_t k) { return k ? first_blocks << (k - 1) : first_blocks; }
+
+        public:
+
+            site_stats_shard()
+                : m_retired(false)
+            {
+                for (std::size_t k = 0; k < segment_count; ++k)
+                    m_segments[k].store(0, std::memory_order_relaxed);
+            }
+
+            ~site_stats_shard()
+            {
+                for (std::size_t k = 0; k < segment_count; ++k)
+                {
+                    block_slot* pSegment = m_segments[k].load(std::memory_order_relaxed);
+                    if (!pSegment)
+                        continue;
+                    for (std::size_t i = 0; i < segment_size(k); ++i)
+                        delete [] pSegment[i].load(std::memory_order_relaxed);
+                    delete [] pSegment;
+                }
+            }
+
+            //! Called only by the owning thread.
+            void count_call(std::size_t siteId)
+            {
+                increment(get_counters(siteId).calls, 1);
+            }
+
+            //! Called only by the owning thread.
+            void record_lookup(std::size_t siteId, lookup_outcome outcome, std::uint64_t nanoseconds)
+            {
+                counters& c = get_counters(siteId);
+                if (outcome == lookup_mocked)
+                    increment(c.mocked, 1);
+                else if (outcome == lookup_miss)
+                    increment(c.misses, 1);
+                increment(c.lookupNanoseconds, nanoseconds);
+            }
+
+            //! Adds this shard's counts to totals (indexed by site id). Safe to call while the owner is counting.
+            void merge(std::vector<site_totals>& totals) const
+            {
+                for (std::size_t k = 0; k < segment_count; ++k)
+                {
+                    const block_slot* pSegment = m_segments[k].load(std::memory_order_acquire);
+                    if (!pSegment)
+                        continue;
+                    for (std::size_t s = 0; s < segment_size(k); ++s)
+                    {
+                        const counters* pBlock = pSegment[s].load(std::memory_order_acquire);
+                        if (!pBlock)
+                            continue;
+                        std::size_t b = segment_base(k) + s;
+                        if (totals.size() < (b + 1) * block_size)
+                            totals.resize((b + 1) * block_size);
+                        for (std::size_t i = 0; i < block_size; ++i)
+                        {
+                            site_totals& t = totals[b * block_size + i];
+                            t.calls += pBlock[i].calls.load(std::memory_order_relaxed);
+                            t.mocked += pBlock[i].mocked.load(std::memory_order_relaxed);
+                            t.misses += pBlock[i].misses.load(std::memory_order_relaxed);
+                            t.lookupNanoseconds += pBlock[i].lookupNanoseconds.load(std::memory_order_relaxed);
+                        }
+                    }
+                }
+            }
+
+            //! Called when the owning thread exits; the shard is folded into the registry's totals on the next read.
+            void retire() { m_retired.store(true, std::memory_order_release); }
+            bool retired() const { return m_retired.load(std::memory_order_acquire); }
+
+        private:
+
+            static void increment(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            counters& get_counters(std::size_t siteId)
+            {
+                std::size_t b = siteId / block_size;
+                std::size_t k = 0;
+                if (BOOST_UNLIKELY(b >= first_blocks))
+                    for (k = 1; b >= segment_base(k + 1); ++k);
+
+                block_slot* pSegment = m_segments[k].load(std::memory_order_relaxed);
+                if (BOOST_UNLIKELY(!pSegment))
+                {
+                    pSegment = new block_slot[segment_size(k)];
+                    for (std::size_t i = 0; i < segment_size(k); ++i)
+                        pSegment[i].store(0, std::memory_order_relaxed);
+                    m_segments[k].store(pSegment, std::memory_order_release);
+                }
+
+                block_slot& slot = pSegment[b - segment_base(k)];
+                counters* pBlock = slot.load(std::memory_order_relaxed);
+                if (BOOST_UNLIKELY(!pBlock))
+                {
+                    pBlock = new counters[block_size];
+                    slot.store(pBlock, std::memory_order_release);
+                }
+                return pBlock[siteId % block_size];
+            }
+
+            std::atomic<block_slot*> m_segments[segment_count];
+            std::atomic<bool>        m_retired;
+        };
+
+        //! \class site_stats_registry
+        //! \brief Tracks the shards of every thread which has counted a call and merges them on read.
+        class site_stats_registry
+        {
+        public:
+
+#if defined(NVM_SHARED_REGISTRY)
+            //! Defined in src/registry.cpp.
+            NVM_REGISTRY_DECL static site_stats_registry& instance();
+#else
+            static site_stats_registry& instance()
+            {
+                static site_stats_registry s_instance;
+                return s_instance;
+            }
+#endif
+
+            boost::shared_ptr<site_stats_shard> create_shard()
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                boost::shared_ptr<site_stats_shard> pShard = boost::make_shared<site_stats_shard>();
+                m_shards.push_back(pShard);
+                return pShard;
+            }
+
+            //! Returns the totals of every thread, live or exited, indexed by site id.
+            std::vector<site_totals> totals()
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                for (std::size_t i = 0; i < m_shards.size();)
+                {
+                    //! A retired shard is no longer written so its counts move to m_exited for good.
+                    if (m_shards[i]->retired())
+                    {
+                        m_shards[i]->merge(m_exited);
+                        m_shards[i] = m_shards.back();
+                        m_shards.pop_back();
+                    }
+                    else
+                        ++i;
+                }
+
+                std::vector<site_totals> result(m_exited);
+                for (std::size_t i = 0; i < m_shards.size(); ++i)
+                    m_shards[i]->merge(result);
+                return result;
+            }
+
+        private:
+
+            std::mutex                                          m_mutex;
+            std::vector< boost::shared_ptr<site_stats_shard> >  m_shards;
+            std::vector<site_totals>                            m_exited;
+        };
+
+        //! Registers the calling thread's shard and arranges for it to be retired when the thread exits.
+        BOOST_NOINLINE inline site_stats_shard& acquire_thread_site_stats()
+        {
+            struct handle
+            {
+                ~handle() { pShard->retire(); }
+                boost::shared_ptr<site_stats_shard> pShard;
+            };
+            static thread_local handle t_handle = { site_stats_registry::instance().create_shard() };
+            return *t_handle.pShard;
+        }
+
+        //! The cached pointer is trivially destructible, so the common case pays no thread_local guard.
+        inline site_stats_shard& thread_site_stats()
+        {
+            static thread_local site_stats_shard* t_pShard = 0;
+            if (BOOST_UNLIKELY(!t_pShard))
+                t_pShard = &acquire_thread_site_stats();
+            return *t_pShard;
+        }
+
+        inline std::uint64_t site_stats_now()
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+    }//! namespace detail;
+}//! namespace nvm;
+
+#endif // NVM_DETAIL_SITESTATSSHARD_HPP
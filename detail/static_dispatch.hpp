@@ -0,0 +1,176 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_STATICDISPATCH_HPP
+#define NVM_DETAIL_STATICDISPATCH_HPP
+#pragma once
+
+//! The part of the compile time mock binding (see static_mock.hpp) which intercept sites need.
+#include "config.hpp"
+#include "mock_site.hpp"
+#include <boost/assert.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if !defined(NVM_HAS_VARIADIC_TEMPLATES)
+    #error "NVM static mocks require variadic templates."
+#endif
+
+namespace nvm
+{
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class static_mockable
+    //! \brief Base of a class template whose intercepts are bound at compile time to Mock.
+    //! static_mockable<void> is the production configuration; its intercepts behave like those of a type
+    //! which implements mockable but is never mocked, without making the type polymorphic.
+    template <typename Mock = void>
+    class static_mockable
+    {
+    public:
+
+        typedef Mock static_mock_type;
+
+        bool is_mocked() const { return false; }
+        const mock_function_base* get_mock_mem_fn(const mock_site&) const { return 0; }
+
+    protected:
+
+        //! Rejects NVM_REGISTER_MOCK_* in static mocks, which would otherwise leave the real implementation
+        //! running. Static mocks are bound at compile time.
+        template <typename MockType, typename OriginalMFN, typename MockMFN>
+        static void register_mocker(OriginalMFN, MockMFN, const std::string&)
+        {
+            static_assert(sizeof(MockType) == 0, "Static mocks bind member functions with NVM_STATIC_MOCK_MEMBER_FUNCTION, not NVM_REGISTER_MOCK_*.");
+        }
+    };
+
+    namespace detail
+    {
+        //! Identifies an intercepted member function at compile time.
+        template <typename MFN, MFN Value>
+        struct static_key
+        {};
+
+        template <typename T, typename Enable = void>
+        struct static_mock_of
+        {
+            typedef void type;
+        };
+
+        template <typename T>
+        struct static_mock_of<T, typename boost::enable_if_has_type<typename T::static_mock_type>::type>
+        {
+            typedef typename T::static_mock_type type;
+        };
+
+        //! True when Mock declares a binding for Key which accepts the parameters of Signature.
+        template <typename Mock, typename Key, typename Signature, typename Enable = void>
+        struct has_static_binding : std::false_type
+        {};
+
+        template <typename Mock, typename Key, typename R, typename... Params>
+        struct has_static_binding
+            <
+                Mock
+              , Key
+              , R(Params...)
+              , typename boost::enable_if_has_type<decltype(std::declval<Mock&>().nvm_static_call(Key(), std::declval<Params>()...))>::type
+            >
+            : std::true_type
+        {};
+
+        template <typename Key, typename Signature>
+        struct has_static_binding<void, Key, Signature> : std::false_type
+        {};
+
+        //! Calls the bound mock member function, forwarding the arguments as forwarding_call does.
+        template <typename Mock, typename Key, typename Signature, bool Bound>
+        struct static_call;
+
+        template <typename Mock, typename Key, typename R, typename... Params>
+        struct static_call<Mock, Key, R(Params...), true>
+        {
+            explicit static_call(Mock* pMock)
+                : pMock(pMock)
+            {}
+
+            template <typename... Args>
+            R operator()(Args&&... args) const
+            {
+                return pMock->nvm_static_call(Key(), static_cast<Params&&>(args)...);
+            }
+
+            Mock* pMock;
+        };
+
+        //! Never called; the intercept only calls through a bound static_call.
+        template <typename Mock, typename Key, typename R, typename... Params>
+        struct static_call<Mock, Key, R(Params...), false>
+        {
+            template <typename T>
+            explicit static_call(const T*)
+            {}
+
+            template <typename... Args>
+            R operator()(Args&&...) const
+            {
+                BOOST_ASSERT(false);
+                std::abort();
+            }
+        };
+
+        template <typename Signature, typename Key, typename T>
+        struct static_dispatch
+        {
+            typedef typename static_mock_of<T>::type mock_type;
+            static const bool value = has_static_binding<mock_type, Key, Signature>::value;
+            typedef static_call<mock_type, Key, Signature, value> call_type;
+
+            static call_type make(const T* pThis, std::true_type)
+            {
+                return call_type(const_cast<mock_type*>(static_cast<const mock_type*>(pThis)));
+            }
+
+            static call_type make(const T* pThis, std::false_type)
+            {
+                return call_type(pThis);
+            }
+        };
+
+        template <typename Signature, typename Key, typename T>
+        inline BOOST_CONSTEXPR bool is_static_mocked(const T*)
+        {
+            return static_dispatch<Signature, Key, T>::value;
+        }
+
+        template <typename Signature, typename Key, typename T>
+        inline typename static_dispatch<Signature, Key, T>::call_type make_static_call(const T* pThis)
+        {
+            typedef static_dispatch<Signature, Key, T> dispatch;
+            return dispatch::make(pThis, std::integral_constant<bool, dispatch::value>());
+        }
+
+    }//! namespace detail;
+}//! namespace nvm;
+
+//! \def NVM_DETAIL_STATIC_INTERCEPT( Sig, MFNType, MFN, ... )
+//! \brief Calls the static mock's member function when the intercepting class is bound to one which binds MFN.
+//! The condition is a compile time constant so unbound intercepts carry no code for it.
+#define NVM_DETAIL_STATIC_INTERCEPT(Sig, MFNType, MFN, ...)                                  \
+    {                                                                                        \
+        typedef nvm::detail::static_key< MFNType, MFN > nvm_static_key;                      \
+        if (nvm::detail::is_static_mocked< Sig, nvm_static_key >(this))                      \
+            return nvm::detail::make_static_call< Sig, nvm_static_key >(this)(__VA_ARGS__);  \
+    }                                                                                        \
+/***/
+
+#endif // NVM_DETAIL_STATICDISPATCH_HPP
@@ -13,15 +13,31 @@
 #include <boost/preprocessor/cat.hpp>
 
 #ifndef NVM_NO_CXX11_THREAD_SAFE_STATIC_LOCAL_VARIABLES
+#include "../mock_context.hpp"
 #include <atomic>
+
+namespace nvm { namespace detail {
+
+    //! Outside of a mock_context the sentinel makes the block run once per process. Inside one the
+    //! block runs once per context, so that mock registrations are repeated in each context.
+    inline bool enter_once_block(std::atomic<bool>& sentinel)
+    {
+        if (mock_context* pContext = current_mock_context())
+            return pContext->enter_once(&sentinel);
+        if (sentinel.load(std::memory_order_acquire))
+            return false;
+        bool expected = false;
+        return sentinel.compare_exchange_strong(expected, true, std::memory_order_seq_cst);
+    }
+
+}}//! namespace nvm::detail;
+
 //! \def NVM_ONCE_BLOCK()
 //! \brief This macro can be used to define the entry to a block which will only be run once even in the context of multiple threads.
+//! When a mock_context is bound to the thread the block is run once per context.
 #define NVM_ONCE_BLOCK()                                                             \
     static std::atomic<bool> BOOST_PP_CAT(nvm_once_block_sentinel,__LINE__)(false);  \
-    bool BOOST_PP_CAT(nvm_once_block_expected,__LINE__) = false;                     \
-    if(BOOST_PP_CAT(nvm_once_block_sentinel,__LINE__).compare_exchange_strong(       \
-                                   BOOST_PP_CAT(nvm_once_block_expected,__LINE__)    \
-                                 , true, std::memory_order_seq_cst))                 \
+    if(nvm::detail::enter_once_block(BOOST_PP_CAT(nvm_once_block_sentinel,__LINE__)))\
 /***/
 
 #else
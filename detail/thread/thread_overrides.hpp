@@ -0,0 +1,102 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_THREAD_THREADOVERRIDES_HPP
+#define NVM_THREAD_THREADOVERRIDES_HPP
+#pragma once
+
+#include "../config.hpp"
+#include "../mock_site.hpp"
+#include <boost/assert.hpp>
+#include <boost/core/ignore_unused.hpp>
+#include <vector>
+
+namespace nvm { namespace detail {
+
+    //! The calling thread's innermost override for each site, indexed by mock_site::id().
+    //! Each scoped_override remembers the entry it replaced, so the table holds the top of a
+    //! per site stack whose links live in the overrides themselves.
+    typedef std::vector<const mock_function_base*> thread_override_table;
+
+#if defined(NVM_SHARED_REGISTRY)
+    //! Defined in src/registry.cpp so that an override installed in one module is seen by every module.
+    NVM_REGISTRY_DECL thread_override_table& thread_overrides();
+#else
+    inline thread_override_table& thread_overrides()
+    {
+        static thread_local thread_override_table t_overrides;
+        return t_overrides;
+    }
+#endif
+
+#if defined(NVM_SHARED_REGISTRY)
+    //! Defined in src/registry.cpp.
+    NVM_REGISTRY_DECL const mock_function_base* pass_through();
+#else
+    //! A marker override which makes the intercept run the real implementation, even on a mock.
+    inline const mock_function_base* pass_through()
+    {
+        static mock_function_base s_passThrough;
+        return &s_passThrough;
+    }
+#endif
+
+    inline const mock_function_base* get_thread_override(std::size_t id)
+    {
+        const thread_override_table& overrides = thread_overrides();
+        return id < overrides.size() ? overrides[id] : 0;
+    }
+
+    //! Makes pFn the calling thread's override for the site and returns the one it replaces.
+    inline const mock_function_base* push_thread_override(std::size_t id, const mock_function_base* pFn)
+    {
+        thread_override_table& overrides = thread_overrides();
+        if (overrides.size() <= id)
+            overrides.resize(id + 1, 0);
+        const mock_function_base* pPrevious = overrides[id];
+        overrides[id] = pFn;
+        return pPrevious;
+    }
+
+    //! Overrides must be popped on the thread which pushed them and in reverse order.
+    inline void pop_thread_override(std::size_t id, const mock_function_base* pFn, const mock_function_base* pPrevious)
+    {
+        thread_override_table& overrides = thread_overrides();
+        BOOST_ASSERT(id < overrides.size() && overrides[id] == pFn);
+        boost::ignore_unused(pFn);
+        overrides[id] = pPrevious;
+    }
+
+    //! \class scoped_pass_through
+    //! \brief Lets a mock call the real implementation of a site from inside its own mock function on this thread.
+    class scoped_pass_through
+    {
+    public:
+
+        explicit scoped_pass_through(std::size_t id)
+            : m_id(id)
+            , m_pPrevious(push_thread_override(id, pass_through()))
+        {}
+
+        ~scoped_pass_through()
+        {
+            pop_thread_override(m_id, pass_through(), m_pPrevious);
+        }
+
+    private:
+
+        scoped_pass_through(const scoped_pass_through&);
+        scoped_pass_through& operator =(const scoped_pass_through&);
+
+        std::size_t               m_id;
+        const mock_function_base* m_pPrevious;
+    };
+
+}}//! namespace nvm::detail;
+
+#endif // NVM_THREAD_THREADOVERRIDES_HPP
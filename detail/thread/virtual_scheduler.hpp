@@ -0,0 +1,140 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_THREAD_VIRTUALSCHEDULER_HPP
+#define NVM_DETAIL_THREAD_VIRTUALSCHEDULER_HPP
+#pragma once
+
+#include "../config.hpp"
+#include <boost/noncopyable.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace nvm { namespace detail {
+
+    //! \class virtual_scheduler
+    //! \brief Virtual time and the threads sleeping in it.
+    //! A sleeping thread waits for the virtual time to reach its deadline. Time moves when advance is called or
+    //! when every participating thread is asleep, in which case it jumps to the earliest deadline. Threads which
+    //! sleep count as participants while they sleep; a thread which does other work between sleeps and must hold
+    //! time back meanwhile joins for that span (see virtual_time::participant).
+    class virtual_scheduler : boost::noncopyable
+    {
+    public:
+
+        virtual_scheduler()
+            : m_now(0)
+            , m_running(0)
+        {}
+
+        std::chrono::nanoseconds now() const
+        {
+            return std::chrono::nanoseconds(m_now.load(std::memory_order_acquire));
+        }
+
+        void advance(std::chrono::nanoseconds d)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            if (d.count() > 0)
+                set_now(now() + d);
+        }
+
+        void join()
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_joined.insert(std::this_thread::get_id());
+            ++m_running;
+        }
+
+        void leave()
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_joined.erase(m_joined.find(std::this_thread::get_id()));
+            --m_running;
+            fast_forward();
+        }
+
+        void sleep_until(std::chrono::nanoseconds deadline)
+        {
+            std::unique_lock<std::mutex> lk(m_mutex);
+            if (deadline <= now())
+                return;
+
+            //! A participant stops running while it sleeps; any other thread is not counted at all. set_now counts
+            //! it as running again when its deadline passes.
+            bool isJoined = m_joined.count(std::this_thread::get_id()) != 0;
+            if (isJoined)
+                --m_running;
+            m_deadlines.insert(std::make_pair(deadline, isJoined));
+            fast_forward();
+            m_cv.wait(lk, [this, deadline]() { return deadline <= now(); });
+        }
+
+    private:
+
+        //! Jumps to the earliest deadline once no participant is running.
+        void fast_forward()
+        {
+            if (m_running == 0 && !m_deadlines.empty())
+                set_now(m_deadlines.begin()->first);
+        }
+
+        //! Retires the deadlines which have passed, and counts their participants as running, before waking
+        //! their sleepers. A thread which sleeps again before the others have woken then neither sees them as
+        //! asleep nor lets time move on without them.
+        void set_now(std::chrono::nanoseconds t)
+        {
+            m_now.store(t.count(), std::memory_order_release);
+            while (!m_deadlines.empty() && m_deadlines.begin()->first <= t)
+            {
+                if (m_deadlines.begin()->second)
+                    ++m_running;
+                m_deadlines.erase(m_deadlines.begin());
+            }
+            m_cv.notify_all();
+        }
+
+        std::atomic<std::int64_t>                       m_now;
+        std::size_t                                     m_running;
+        std::multimap<std::chrono::nanoseconds, bool>   m_deadlines;
+        std::multiset<std::thread::id>                  m_joined;
+        std::mutex                                      m_mutex;
+        std::condition_variable                         m_cv;
+    };
+
+#if defined(NVM_SHARED_REGISTRY)
+    //! Defined in src/registry.cpp.
+    NVM_REGISTRY_DECL std::atomic<virtual_scheduler*>& active_scheduler();
+#else
+    //! The scheduler of the virtual_time in effect, or null when time is real.
+    inline std::atomic<virtual_scheduler*>& active_scheduler()
+    {
+        static std::atomic<virtual_scheduler*> s_pScheduler(0);
+        return s_pScheduler;
+    }
+#endif
+
+    //! Sleeps in virtual time if a virtual_time is in effect and in real time otherwise.
+    inline void sleep_for(std::chrono::nanoseconds d)
+    {
+        if (virtual_scheduler* pScheduler = active_scheduler().load(std::memory_order_acquire))
+            pScheduler->sleep_until(pScheduler->now() + d);
+        else
+            std::this_thread::sleep_for(d);
+    }
+
+}}//! namespace nvm::detail;
+
+#endif // NVM_DETAIL_THREAD_VIRTUALSCHEDULER_HPP
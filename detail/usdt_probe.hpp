@@ -0,0 +1,75 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_DETAIL_USDTPROBE_HPP
+#define NVM_DETAIL_USDTPROBE_HPP
+#pragma once
+
+//! A USDT (SystemTap SDT) probe, nvmock:call, for intercept sites compiled with NVM_ENABLE_USDT.
+//! A probe is a single nop plus an ELF note describing where its arguments live; perf, bpftrace and
+//! SystemTap patch the nop into a breakpoint only while they are attached. The arguments are:
+//!   arg0: the site name as written at the intercept (const char*),
+//!   arg1: the intercepting object, or null at a function intercept,
+//!   arg2: 1 if the call was redirected to a mock, 0 if the real implementation runs.
+//! \code
+//! bpftrace -e 'usdt:./app:nvmock:call { @calls[str(arg0), arg2] = count(); }'
+//! perf buildid-cache --add ./app && perf record -e sdt_nvmock:call -p <pid>
+//! \endcode
+//! <sys/sdt.h> is used when it is available. Otherwise the note is emitted here for x86-64 and AArch64
+//! Linux in the same format; on other targets NVM_DETAIL_USDT_CALL expands to nothing.
+#include <boost/config.hpp>
+
+#if defined(__has_include)
+    #if __has_include(<sys/sdt.h>)
+        #define NVM_DETAIL_HAS_SYS_SDT
+    #endif
+#endif
+
+#if defined(NVM_DETAIL_HAS_SYS_SDT)
+    #include <sys/sdt.h>
+    #define NVM_DETAIL_USDT_CALL(Name, pObject, IsMocked)                            \
+        DTRACE_PROBE3(nvmock, call, Name, pObject, IsMocked)                         \
+    /***/
+#elif defined(__GNUC__) && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+    //! The body of a stapsdt v3 note: the probe address, the base address used to detect prelinking, the
+    //! (absent) semaphore, then the provider, probe name and argument description. Arguments are given as
+    //! size@operand, with the operands filled in by the compiler from the "nor" constraints.
+    #define NVM_DETAIL_USDT_CALL(Name, pObject, IsMocked)                            \
+        __asm__ __volatile__(                                                        \
+            "990: nop\n"                                                             \
+            ".pushsection .note.stapsdt,\"?\",\"note\"\n"                            \
+            ".balign 4\n"                                                            \
+            ".4byte 992f-991f, 994f-993f, 3\n"                                       \
+            "991: .asciz \"stapsdt\"\n"                                              \
+            "992: .balign 4\n"                                                       \
+            "993: .8byte 990b\n"                                                     \
+            ".8byte _.stapsdt.base\n"                                                \
+            ".8byte 0\n"                                                             \
+            ".asciz \"nvmock\"\n"                                                    \
+            ".asciz \"call\"\n"                                                      \
+            ".asciz \"8@%0 8@%1 4@%2\"\n"                                            \
+            "994: .balign 4\n"                                                       \
+            ".popsection\n"                                                          \
+            ".ifndef _.stapsdt.base\n"                                               \
+            ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"  \
+            ".weak _.stapsdt.base\n"                                                 \
+            ".hidden _.stapsdt.base\n"                                               \
+            "_.stapsdt.base: .space 1\n"                                             \
+            ".size _.stapsdt.base, 1\n"                                              \
+            ".popsection\n"                                                          \
+            ".endif\n"                                                               \
+            :                                                                        \
+            : "nor"(static_cast<const char*>(Name))                                  \
+            , "nor"(static_cast<const void*>(pObject))                               \
+            , "nor"(static_cast<int>(IsMocked)))                                     \
+    /***/
+#else
+    #define NVM_DETAIL_USDT_CALL(Name, pObject, IsMocked)
+#endif
+
+#endif // NVM_DETAIL_USDTPROBE_HPP
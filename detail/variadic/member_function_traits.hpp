@@ -0,0 +1,66 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+//! Variadic implementation of member_function_traits.
+//! This is used in place of the preprocessed arity specializations when the compiler supports
+//! variadic templates. Parameter types of any index are available through arg<N>::type. The
+//! Arg0Type..Arg9Type typedefs of the preprocessed version are kept for compatibility.
+//
+#include <cstddef>
+#include <tuple>
+
+namespace nvm {
+
+    namespace detail
+    {
+        struct no_member_function_arg;
+
+        template <std::size_t N, typename Tuple, bool InRange = (N < std::tuple_size<Tuple>::value)>
+        struct member_function_arg
+        {
+            typedef typename std::tuple_element<N, Tuple>::type type;
+        };
+
+        template <std::size_t N, typename Tuple>
+        struct member_function_arg<N, Tuple, false>
+        {
+            typedef no_member_function_arg type;
+        };
+    }//! namespace detail;
+
+    struct member_function_traits
+    {
+        template <typename Signature>
+        struct result;
+
+        template <typename RT, typename T, typename... A>
+        struct result<member_function_traits(T*, RT(T::*)(A...))>
+        {
+            typedef T* ClassType;
+            typedef RT(T::*MemFnPtr)(A...);
+            typedef RT SignatureType(A...);
+            typedef RT ReturnType;
+
+            template <std::size_t N>
+            struct arg : detail::member_function_arg<N, std::tuple<A...> >
+            {};
+
+            typedef typename arg<0>::type Arg0Type;
+            typedef typename arg<1>::type Arg1Type;
+            typedef typename arg<2>::type Arg2Type;
+            typedef typename arg<3>::type Arg3Type;
+            typedef typename arg<4>::type Arg4Type;
+            typedef typename arg<5>::type Arg5Type;
+            typedef typename arg<6>::type Arg6Type;
+            typedef typename arg<7>::type Arg7Type;
+            typedef typename arg<8>::type Arg8Type;
+            typedef typename arg<9>::type Arg9Type;
+        };
+    };
+
+}//namespace nvm;
@@ -0,0 +1,50 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+//! Variadic implementation of the mock function factory (mem_fn_ptr_gen is in member_function_traits.hpp).
+//! This is used in place of the preprocessed arity specializations when the compiler supports
+//! variadic templates. There is no limit on the number of member function parameters.
+//
+namespace nvm {
+
+    namespace detail
+    {
+        //! Binds a mock member function to a mock instance. This replaces boost::bind with placeholders
+        //! and forwards the call arguments straight through to the member function.
+        template <typename MFN, typename T>
+        struct bound_mem_fn
+        {
+            bound_mem_fn(MFN pMFN, T* pThis)
+                : pMFN(pMFN)
+                , pThis(pThis)
+            {}
+
+            template <typename... Args>
+            auto operator()(Args&&... args) const -> decltype((std::declval<T*>()->*std::declval<MFN>())(std::forward<Args>(args)...))
+            {
+                return (pThis->*pMFN)(std::forward<Args>(args)...);
+            }
+
+            MFN pMFN;
+            T*  pThis;
+        };
+    }//! namespace detail;
+
+    //! The variadic factory handles every arity with the primary template.
+    template <unsigned int Arity>
+    struct mock_function_factory
+    {
+        template <typename OriginalMFN, typename MockMFN, typename T>
+        static boost::shared_ptr<mock_function_base> create(OriginalMFN, MockMFN mpMFN, T* pThis)
+        {
+            typedef typename signature_of_mem_fn<OriginalMFN>::type sig_type;
+            return boost::make_shared< mock_function<sig_type> >(detail::bound_mem_fn<MockMFN, T>(mpMFN, pThis));
+        }
+    };
+
+}//namespace nvm;
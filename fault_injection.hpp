@@ -0,0 +1,59 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_FAULTINJECTION_HPP
+#define NVM_FAULTINJECTION_HPP
+#pragma once
+
+//! Fault and latency injection at intercept sites.
+//! Intercept sites compiled with NVM_ENABLE_FAULT_INJECTION defined consult a set of rules, keyed by the site
+//! name as written at the intercept (MyClass::MemberFunction), which may delay the call, throw injected_fault
+//! from it or return a value in its place. No mock is needed, so a production build compiled with the flag can
+//! be exercised for resilience. While no rules are loaded a site costs one relaxed load; sites compiled without
+//! the flag carry no injection code.
+//!
+//! Rules are read from the files named by NVM_FAULTS_FILE and from NVM_FAULTS (rules separated by ';') when
+//! the first site is reached, or loaded with the functions below. See detail::fault_registry::load for the format.
+//! Sampling is deterministic: with the same seed and the same order of calls at a site the same calls fault.
+//! Delays are taken in virtual time while an nvm::virtual_time is alive (see virtual_time.hpp).
+#include "detail/fault_rules.hpp"
+
+#include <fstream>
+#include <istream>
+#include <string>
+
+namespace nvm
+{
+    //! \brief Replaces the loaded rules with those read from is.
+    //! \throws std::invalid_argument if a rule cannot be parsed, in which case the loaded rules are kept.
+    inline void load_fault_rules(std::istream& is)
+    {
+        detail::fault_registry::instance().load(is);
+    }
+
+    //! \brief Replaces the loaded rules with those in the file at path.
+    //! \return false if the file cannot be opened.
+    //! \throws std::invalid_argument if a rule cannot be parsed, in which case the loaded rules are kept.
+    inline bool load_fault_rules_file(const std::string& path)
+    {
+        std::ifstream is(path.c_str());
+        if (!is)
+            return false;
+        load_fault_rules(is);
+        return true;
+    }
+
+    //! \brief Removes every rule.
+    inline void clear_fault_rules()
+    {
+        detail::fault_registry::instance().clear();
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_FAULTINJECTION_HPP
@@ -0,0 +1,156 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_FUNCTIONMOCK_HPP
+#define NVM_FUNCTIONMOCK_HPP
+#pragma once
+
+#include "mockable.hpp"
+#include "detail/mock_context.hpp"
+
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/remove_pointer.hpp>
+#include <mutex>
+#include <vector>
+
+namespace nvm
+{
+    namespace detail
+    {
+        //! The mocker of a free or static member function: one callable shared by every call.
+        template <typename Signature>
+        class function_mocker : public mocker
+        {
+        public:
+
+            template <typename Fn>
+            void set(Fn fn) { m_pFn = boost::make_shared< mock_function<Signature> >(fn); }
+            void reset() { m_pFn.reset(); }
+
+            boost::shared_ptr<mock_function_base> operator()(void*) const { return m_pFn; }
+            const mock_function_base* get_function() const { return m_pFn.get(); }
+
+        private:
+
+            boost::shared_ptr< mock_function<Signature> > m_pFn;
+        };
+
+        //! \class function_mocker_pool
+        //! \brief The mockers of the function mocks of one signature, reused by later function mocks.
+        //! Function mocks publish pooled mockers without handing them to the registry or context to retain, so
+        //! constructing function mocks repeatedly (in a loop or a parameterized test) does not grow memory. The
+        //! pool keeps as many mockers as there have been function mocks of the signature alive at once, for the
+        //! life of the process; each function mock still allocates its callable, which is freed when it ends.
+        template <typename Signature>
+        class function_mocker_pool : boost::noncopyable
+        {
+        public:
+
+            static function_mocker_pool& instance()
+            {
+                static function_mocker_pool s_instance;
+                return s_instance;
+            }
+
+            function_mocker<Signature>* acquire()
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                if (!m_free.empty())
+                {
+                    function_mocker<Signature>* pMocker = m_free.back();
+                    m_free.pop_back();
+                    return pMocker;
+                }
+                m_mockers.push_back(boost::make_shared< function_mocker<Signature> >());
+                return m_mockers.back().get();
+            }
+
+            void release(function_mocker<Signature>* pMocker)
+            {
+                pMocker->reset();
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_free.push_back(pMocker);
+            }
+
+        private:
+
+            std::mutex                                                      m_mutex;
+            std::vector< boost::shared_ptr< function_mocker<Signature> > >  m_mockers;
+            std::vector< function_mocker<Signature>* >                      m_free;
+        };
+
+    }//! namespace detail;
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class function_mock
+    //! \brief Redirects a free or static member function intercepted with NVM_FUNCTION_INTERCEPT to a callable.
+    //! While the mock is alive every call to the function, on any thread, goes to the callable. When a
+    //! mock_context is bound to the constructing thread the redirection applies only to threads bound to that
+    //! context. Function mocks nest; destroying one reinstates the one it replaced, so they must be destroyed
+    //! in reverse order of construction within a context, and after the calls they redirect have returned. The
+    //! function must be named the same way as at the intercept (e.g. both ns::Function).
+    //! Use the NVM_FUNCTION_MOCK macros rather than naming the site key directly.
+    template <typename Signature>
+    class function_mock : boost::noncopyable
+    {
+    public:
+
+        template <typename Fn>
+        function_mock(Signature* pFunction, const std::string& functionName, Fn fn)
+            : m_site(get_mock_site(pFunction, functionName))
+            , m_pContext(detail::current_mock_context())
+            , m_pPrevious(m_pContext ? m_pContext->get_mocker(m_site) : m_site.get_mocker())
+            , m_pMocker(detail::function_mocker_pool<Signature>::instance().acquire())
+        {
+            m_pMocker->set(fn);
+            //! The pool owns the mocker, so it is published as a reinstatement rather than retained.
+            detail::restore_mocker(m_site, m_pMocker, m_pContext);
+            detail::live_mock_count().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ~function_mock()
+        {
+            detail::restore_mocker(m_site, m_pPrevious, m_pContext);
+            detail::function_mocker_pool<Signature>::instance().release(m_pMocker);
+            detail::live_mock_count().fetch_sub(1, std::memory_order_relaxed);
+        }
+
+    private:
+
+        mock_site&                          m_site;
+        mock_context*                       m_pContext;
+        mocker*                             m_pPrevious;
+        detail::function_mocker<Signature>* m_pMocker;
+    };
+
+}//! namespace nvm;
+
+//! \def NVM_FUNCTION_MOCK( Name, Function, Fn )
+//! \brief Declares a function_mock variable Name which redirects Function to Fn.
+//! Example usage:
+//! \code
+//! {
+//!     NVM_FUNCTION_MOCK(clock, Clock::Now, [](int) { return std::int64_t(42); });
+//!     ...
+//! }
+//! \endcode
+#define NVM_FUNCTION_MOCK(Name, Function, Fn)                                                                                   \
+    nvm::function_mock< boost::remove_pointer<NVM_TYPEOF(&Function)>::type > Name(&Function, BOOST_PP_STRINGIZE(Function), Fn) \
+/***/
+
+//! \def NVM_FUNCTION_OVERLOAD_MOCK( Name, Function, Signature, Fn )
+//! \brief Declares a function_mock variable Name for one overload of Function.
+#define NVM_FUNCTION_OVERLOAD_MOCK(Name, Function, Signature, Fn)                                                               \
+    nvm::function_mock< Signature > Name(&Function, BOOST_PP_STRINGIZE(Function), Fn)                                           \
+/***/
+
+#endif // NVM_FUNCTIONMOCK_HPP
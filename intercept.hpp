@@ -0,0 +1,470 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_INTERCEPT_HPP
+#define NVM_INTERCEPT_HPP
+#pragma once
+
+//! The intercept side of nvmock: the mockable base class and the NVM_MOCK_*INTERCEPT macros.
+//! Production code which only declares intercept sites includes this header. It does not pull in the
+//! machinery which builds mocks (mock_function_factory.hpp, mock.hpp), so it costs little to compile.
+//! Test code includes mockable.hpp or mock.hpp.
+#include "detail/config.hpp"
+#include "detail/mock_site.hpp"
+#include "detail/mock_gate.hpp"
+#include "detail/mock_function.hpp"
+#include "detail/thread/thread_overrides.hpp"
+#include "member_function_traits.hpp"
+#if defined(NVM_ENABLE_CALL_TRACE)
+    #include "detail/call_trace_buffer.hpp"
+#endif
+#if defined(NVM_ENABLE_SITE_STATS)
+    #include "detail/site_stats_shard.hpp"
+#endif
+#if defined(NVM_ENABLE_FAULT_INJECTION)
+    #include "detail/fault_rules.hpp"
+#endif
+#if defined(NVM_ENABLE_USDT)
+    #include "detail/usdt_probe.hpp"
+#endif
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+    #include "detail/static_dispatch.hpp"
+#else
+    //! mem_fn_ptr_gen is generated with the factory when variadic templates are unavailable.
+    #include "mock_function_factory.hpp"
+    #define NVM_DETAIL_STATIC_INTERCEPT(Sig, MFNType, MFN, ...)
+#endif
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/type_traits/remove_pointer.hpp>
+#include <boost/config.hpp>
+#include <string>
+#include <typeinfo>
+
+namespace nvm
+{
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class mockable
+    //! \brief Inherit from this class to allow non-virtual member functions to be mockable.
+    //! This type can be used as a base type for classes and structs which have non-virtual
+    //! member functions which need to be mocked.
+    //! for the example usage.
+    class mockable
+    {
+    public:
+        mockable(){}
+        virtual ~mockable(){}
+
+        virtual bool is_mocked() const { return false; }
+        virtual const mock_function_base* get_mock_mem_fn(const mock_site& site) const { return 0; }
+    };
+
+    template <typename MFN>
+    inline std::string get_mock_mem_fn_key(MFN, const std::string& methodName)
+    {
+        return methodName + typeid(MFN).name();
+    }
+
+    //! Look up (or create) the registry entry for a member function.
+    //! Intercept sites call this once and cache the result in a function local static.
+    template <typename MFN>
+    inline mock_site& get_mock_site(MFN mfn, const std::string& methodName)
+    {
+        return detail::site_registry::instance().get_site(get_mock_mem_fn_key(mfn, methodName), methodName);
+    }
+
+    namespace detail
+    {
+        //! A scoped_override on the calling thread takes precedence over the object's own mock and a
+        //! scoped_pass_through runs the real implementation. isMiss is set when the object is mocked but
+        //! has no mocker registered for the site.
+        template <typename Sig, typename T>
+        inline const mock_function<Sig>* lookup_mock_fn(const T& obj, const mock_site& site, bool& isMiss)
+        {
+            if (const mock_function_base* pOverride = get_thread_override(site.id()))
+                return pOverride != pass_through() ? mock_function_cast<Sig>(pOverride) : 0;
+            if (!obj.is_mocked())
+                return 0;
+            const mock_function_base* pMockFn = obj.get_mock_mem_fn(site);
+            isMiss = !pMockFn;
+            return mock_function_cast<Sig>(pMockFn);
+        }
+
+        //! The cold half of an intercept. This is only reached when some mock or scoped_override is alive
+        //! in the process and is kept out of line so that the instrumented function carries nothing but the
+        //! gate check. SiteTag is a type local to the intercept so that each site gets its own cached mock_site.
+        template <typename Sig, typename SiteTag, typename T, typename MFN>
+        BOOST_NOINLINE const mock_function<Sig>* find_mock_fn(const T& obj, MFN mfn, const char* methodName)
+        {
+            static mock_site& site = get_mock_site(mfn, methodName);
+            bool isMiss = false;
+#if defined(NVM_ENABLE_SITE_STATS)
+            std::uint64_t start = site_stats_now();
+            const mock_function<Sig>* pMockFn = lookup_mock_fn<Sig>(obj, site, isMiss);
+            thread_site_stats().record_lookup(site.id(), pMockFn ? lookup_mocked : isMiss ? lookup_miss : lookup_real, site_stats_now() - start);
+            return pMockFn;
+#else
+            return lookup_mock_fn<Sig>(obj, site, isMiss);
+#endif
+        }
+
+        //! Spells the function pointer type of a signature (Sig* does not parse for a signature written inline).
+        template <typename Sig>
+        struct function_ptr
+        {
+            typedef Sig* type;
+        };
+
+        //! As lookup_mock_fn, a scoped_override or scoped_pass_through on the calling thread takes precedence.
+        template <typename Sig>
+        inline const mock_function<Sig>* lookup_function_mock_fn(const mock_site& site)
+        {
+            if (const mock_function_base* pOverride = get_thread_override(site.id()))
+                return pOverride != pass_through() ? mock_function_cast<Sig>(pOverride) : 0;
+            const mocker* pMocker = get_mocker(site, current_context());
+            return pMocker ? mock_function_cast<Sig>(pMocker->get_function()) : 0;
+        }
+
+        //! The cold half of a free or static member function intercept. Functions have no object so the
+        //! mocker is taken from the context bound to the calling thread or the process wide registry.
+        template <typename Sig, typename SiteTag, typename Fn>
+        BOOST_NOINLINE const mock_function<Sig>* find_function_mock_fn(Fn fn, const char* functionName)
+        {
+            static mock_site& site = get_mock_site(fn, functionName);
+#if defined(NVM_ENABLE_SITE_STATS)
+            std::uint64_t start = site_stats_now();
+#endif
+            const mock_function<Sig>* pMockFn = lookup_function_mock_fn<Sig>(site);
+#if defined(NVM_ENABLE_SITE_STATS)
+            thread_site_stats().record_lookup(site.id(), pMockFn ? lookup_mocked : lookup_real, site_stats_now() - start);
+#endif
+            return pMockFn;
+        }
+
+#if defined(NVM_ENABLE_CALL_TRACE)
+        //! Resolves the site id once per intercept and returns a recorder to be called with the arguments.
+        template <typename SiteTag, typename MFN>
+        inline call_recorder trace_call(MFN mfn, const char* methodName, const void* pThis)
+        {
+            static const std::size_t id = get_mock_site(mfn, methodName).id();
+            return call_recorder(id, pThis);
+        }
+#endif
+
+#if defined(NVM_ENABLE_SITE_STATS)
+        //! Counts a call at an intercept site, resolving the site id once per intercept.
+        template <typename SiteTag, typename MFN>
+        inline void count_call(MFN mfn, const char* methodName)
+        {
+            static const std::size_t id = get_mock_site(mfn, methodName).id();
+            thread_site_stats().count_call(id);
+        }
+#endif
+    }//! namespace detail;
+
+}//! namespace nvm;
+
+#if !defined(NVM_NO_NONVIRTUAL_MOCK_INTERCEPT)
+    //! \def NVM_DETAIL_TRACE_CALL( MFN, Name, pObject, ... )
+    //! \brief Records the call in the thread's call trace when NVM_ENABLE_CALL_TRACE is defined (see call_trace.hpp).
+    //! pObject is the intercepting object, or null for a function intercept.
+    #if defined(NVM_ENABLE_CALL_TRACE)
+        #define NVM_DETAIL_TRACE_CALL(MFN, Name, pObject, ...)                       \
+            if (BOOST_UNLIKELY(nvm::call_trace_enabled()))                           \
+            {                                                                        \
+                struct nvm_trace_site_tag {};                                        \
+                nvm::detail::trace_call< nvm_trace_site_tag >                        \
+                (MFN, Name, pObject)(__VA_ARGS__);                                   \
+            }                                                                        \
+        /***/
+    #else
+        #define NVM_DETAIL_TRACE_CALL(MFN, Name, pObject, ...)
+    #endif
+    //! \def NVM_DETAIL_COUNT_CALL( MFN, Name )
+    //! \brief Counts the call in the site's telemetry when NVM_ENABLE_SITE_STATS is defined (see site_stats.hpp).
+    #if defined(NVM_ENABLE_SITE_STATS)
+        #define NVM_DETAIL_COUNT_CALL(MFN, Name)                                     \
+            {                                                                        \
+                struct nvm_stats_site_tag {};                                        \
+                nvm::detail::count_call< nvm_stats_site_tag >(MFN, Name);            \
+            }                                                                        \
+        /***/
+    #else
+        #define NVM_DETAIL_COUNT_CALL(MFN, Name)
+    #endif
+    //! \def NVM_DETAIL_INJECT_FAULT( Sig, Name )
+    //! \brief Applies the fault rules of the site when NVM_ENABLE_FAULT_INJECTION is defined (see fault_injection.hpp).
+    //! The inline part is one relaxed load which is false unless rules are loaded.
+    #if defined(NVM_ENABLE_FAULT_INJECTION)
+        #define NVM_DETAIL_INJECT_FAULT(Sig, Name)                                   \
+            if (BOOST_UNLIKELY(nvm::fault_injection_enabled()))                      \
+            {                                                                        \
+                struct nvm_fault_site_tag {};                                        \
+                nvm::detail::injected_result                                         \
+                <NVM_TYPENAME boost::function_types::result_type< Sig >::type> nvm_r;\
+                if (nvm::detail::inject_fault< nvm_fault_site_tag >(Name, nvm_r))    \
+                    return nvm_r.get();                                              \
+            }                                                                        \
+        /***/
+    #else
+        #define NVM_DETAIL_INJECT_FAULT(Sig, Name)
+    #endif
+    //! \def NVM_DETAIL_PROBE_CALL( Name, pObject, IsMocked )
+    //! \brief Fires the nvmock:call USDT probe when NVM_ENABLE_USDT is defined (see detail/usdt_probe.hpp).
+    //! The probe is a nop unless a tracer is attached.
+    #if defined(NVM_ENABLE_USDT)
+        #define NVM_DETAIL_PROBE_CALL(Name, pObject, IsMocked)                       \
+            NVM_DETAIL_USDT_CALL(Name, pObject, IsMocked);                           \
+        /***/
+    #else
+        #define NVM_DETAIL_PROBE_CALL(Name, pObject, IsMocked)
+    #endif
+    //! \def NVM_DETAIL_MOCK_INTERCEPT( Sig, MFN, Name, ... )
+    //! \brief Implementation shared by the intercept macros below.
+    //! The inline part is one relaxed load of the live mock counter. Everything else, including the
+    //! is_mocked() check and the registry lookup, lives in nvm::detail::find_mock_fn. Arguments are
+    //! forwarded to the mock according to the declared parameter types (see forwarding_call).
+    #define NVM_DETAIL_MOCK_INTERCEPT(Sig, MFN, Name, ...)                           \
+        NVM_DETAIL_COUNT_CALL(MFN, Name)                                             \
+        NVM_DETAIL_TRACE_CALL(MFN, Name, this, __VA_ARGS__)                          \
+        NVM_DETAIL_INJECT_FAULT(Sig, Name)                                           \
+        if (BOOST_UNLIKELY(nvm::any_mock_alive()))                                   \
+        {                                                                            \
+            struct nvm_mock_site_tag {};                                             \
+            if (const nvm::mock_function< Sig >* pMockFn =                           \
+                nvm::detail::find_mock_fn< Sig, nvm_mock_site_tag >                  \
+                (*this, MFN, Name))                                                  \
+            {                                                                        \
+                NVM_DETAIL_PROBE_CALL(Name, this, 1)                                 \
+                return nvm::detail::make_forwarding_call(*pMockFn)(__VA_ARGS__);     \
+            }                                                                        \
+        }                                                                            \
+        NVM_DETAIL_PROBE_CALL(Name, this, 0)                                         \
+    /***/
+    //! \def NVM_MOCK_INTERCEPT( Method, ... )
+    //! \brief Macro to implement a non-virtual mock function intercept.
+    //!
+    //! Preconditions:
+    //! Method is a fully qualified member function name (i.e. MyClass::MemberFunction).
+    //! ... (variadic preprocessor args) are the parameter names of the arguments passed into the
+    //!     member function.
+    //!
+    //! Example usage:
+    //! \code
+    //! bool MyClass::MemberFunction(int a, double b)
+    //! {
+    //!     NVM_MOCK_INTERCEPT(MyClass::MemberFunction, a, b);
+    //!     return a < b;
+    //! }
+    //! \endcode
+    #define NVM_MOCK_INTERCEPT(Method, ...)                                          \
+        NVM_DETAIL_STATIC_INTERCEPT(                                                 \
+            NVM_TYPENAME signature_of_mem_fn<NVM_TYPEOF(&Method)>::type              \
+          , NVM_TYPEOF(&Method)                                                      \
+          , &Method                                                                  \
+          , __VA_ARGS__)                                                             \
+        NVM_DETAIL_MOCK_INTERCEPT(                                                   \
+            NVM_TYPENAME signature_of_mem_fn<NVM_TYPEOF(&Method)>::type              \
+          , &Method                                                                  \
+          , BOOST_PP_STRINGIZE(Method)                                               \
+          , __VA_ARGS__)                                                             \
+    /***/
+    //! \def NVM_MOCK_INTERCEPT_SIG( Method, Signature, ... )
+    //! \brief Macro to implement a non-virtual mock function intercept.
+    //! This signature version can be used in cases when the boost::function facility
+    //! fails to deduce the signature automatically.
+    //! Preconditions:
+    //! Method is a fully qualified member function name (i.e. MyClass::MemberFunction).
+    //! Signature is the signature of the member function.
+    //! ... (variadic preprocessor args) are the parameter names of the arguments passed into the
+    //!     member function.    
+    //!
+    //! Example usage:
+    //! \code
+    //! bool MyClass::MemberFunction(int a, double b)
+    //! {
+    //!     NVM_MOCK_INTERCEPT_SIG(MyClass::MemberFunction, bool(int, double), a, b);
+    //!     return a < b;
+    //! }
+    //! \endcode
+    #define NVM_MOCK_INTERCEPT_SIG(Method, Signature, ...)                           \
+        NVM_DETAIL_STATIC_INTERCEPT(Signature                                        \
+          , NVM_TYPEOF(&Method)                                                      \
+          , &Method                                                                  \
+          , __VA_ARGS__)                                                             \
+        NVM_DETAIL_MOCK_INTERCEPT(Signature                                          \
+          , &Method                                                                  \
+          , BOOST_PP_STRINGIZE(Method)                                               \
+          , __VA_ARGS__)                                                             \
+    /***/
+    //! \def NVM_MOCK_OVERLOAD_INTERCEPT( Type, Method, Signature, ... )
+    //! \brief Macro to implement a non-virtual mock function intercept for overloaded non-const member functions.
+    //!
+    //! Preconditions:
+    //! Type is the class name.
+    //! Method is the unqualified member function name (i.e. MemberFunction).
+    //! Signature is the signature of the member function.
+    //! ... (variadic preprocessor args) are the parameter names of the arguments passed into the
+    //!     member function.
+    //!
+    //! Example usage:
+    //! \code
+    //! bool MyClass::MemberFunction(int a, double b)
+    //! {
+    //!     NVM_MOCK_OVERLOAD_INTERCEPT(MyClass, MemberFunction, bool(int, double), a, b);
+    //!     return a < b;
+    //! }
+    //! \endcode
+    #define NVM_MOCK_OVERLOAD_INTERCEPT(T, Method, Sig, ...)                         \
+        NVM_DETAIL_STATIC_INTERCEPT(Sig                                              \
+          , NVM_TYPENAME nvm::mem_fn_ptr_gen<Sig>::template apply<T>::type           \
+          , &T::Method                                                               \
+          , __VA_ARGS__)                                                             \
+        NVM_DETAIL_MOCK_INTERCEPT(Sig                                                \
+          , NVM_TYPENAME nvm::mem_fn_ptr_gen<Sig>::template apply<T>::type()         \
+          , BOOST_PP_STRINGIZE(T::Method)                                            \
+          , __VA_ARGS__)                                                             \
+    /***/
+    //! \def NVM_MOCK_OVERLOAD_CONST_INTERCEPT( Type, Method, Signature, ... )
+    //! \brief Macro to implement a non-virtual mock function intercept for overloaded const member functions.
+    //!
+    //! Preconditions:
+    //! Type is the class name.
+    //! Method is the unqualified member function name (i.e. MemberFunction).
+    //! Signature is the signature of the member function.
+    //! ... (variadic preprocessor args) are the parameter names of the arguments passed into the
+    //!     member function.
+    //!
+    //! Example usage:
+    //! \code
+    //! bool MyClass::MemberFunction(int a, double b) const
+    //! {
+    //!     NVM_MOCK_OVERLOAD_CONST_INTERCEPT(MyClass, MemberFunction, bool(int, double), a, b);
+    //!     return a < b;
+    //! }
+    //! \endcode
+    #define NVM_MOCK_OVERLOAD_CONST_INTERCEPT(T, Method, Sig, ...)                   \
+        NVM_DETAIL_STATIC_INTERCEPT(Sig                                              \
+          , NVM_TYPENAME nvm::mem_fn_ptr_gen<Sig>::template apply<T>::const_type     \
+          , &T::Method                                                               \
+          , __VA_ARGS__)                                                             \
+        NVM_DETAIL_MOCK_INTERCEPT(Sig                                                \
+          , NVM_TYPENAME nvm::mem_fn_ptr_gen<Sig>::template apply<T>::const_type()   \
+          , BOOST_PP_STRINGIZE(T::Method)                                            \
+          , __VA_ARGS__)                                                             \
+    /***/
+
+    //! \def NVM_DETAIL_FUNCTION_INTERCEPT( Sig, Fn, Name, ... )
+    //! \brief Implementation shared by the function intercept macros below. The inline part is the same
+    //! gate check as for member functions; the lookup lives in nvm::detail::find_function_mock_fn.
+    #define NVM_DETAIL_FUNCTION_INTERCEPT(Sig, Fn, Name, ...)                        \
+        NVM_DETAIL_COUNT_CALL(Fn, Name)                                              \
+        NVM_DETAIL_TRACE_CALL(Fn, Name, 0, __VA_ARGS__)                              \
+        NVM_DETAIL_INJECT_FAULT(Sig, Name)                                           \
+        if (BOOST_UNLIKELY(nvm::any_mock_alive()))                                   \
+        {                                                                            \
+            struct nvm_mock_site_tag {};                                             \
+            if (const nvm::mock_function< Sig >* pMockFn =                           \
+                nvm::detail::find_function_mock_fn< Sig, nvm_mock_site_tag >         \
+                (Fn, Name))                                                          \
+            {                                                                        \
+                NVM_DETAIL_PROBE_CALL(Name, 0, 1)                                    \
+                return nvm::detail::make_forwarding_call(*pMockFn)(__VA_ARGS__);     \
+            }                                                                        \
+        }                                                                            \
+        NVM_DETAIL_PROBE_CALL(Name, 0, 0)                                            \
+    /***/
+    //! \def NVM_FUNCTION_INTERCEPT( Function, ... )
+    //! \brief Macro to implement a mock intercept in a free function or static member function.
+    //! The function is redirected while a function_mock for it is alive (see function_mock.hpp).
+    //!
+    //! Preconditions:
+    //! Function is the qualified function name (i.e. ns::Function or MyClass::StaticFunction).
+    //! ... (variadic preprocessor args) are the parameter names of the arguments passed into the function.
+    //!
+    //! Example usage:
+    //! \code
+    //! std::int64_t Clock::Now(int clockId)
+    //! {
+    //!     NVM_FUNCTION_INTERCEPT(Clock::Now, clockId);
+    //!     return ReadClock(clockId);
+    //! }
+    //! \endcode
+    #define NVM_FUNCTION_INTERCEPT(Function, ...)                                    \
+        NVM_DETAIL_FUNCTION_INTERCEPT(                                               \
+            NVM_TYPENAME boost::remove_pointer<NVM_TYPEOF(&Function)>::type          \
+          , &Function                                                                \
+          , BOOST_PP_STRINGIZE(Function)                                             \
+          , __VA_ARGS__)                                                             \
+    /***/
+    //! \def NVM_FUNCTION_OVERLOAD_INTERCEPT( Function, Signature, ... )
+    //! \brief Macro to implement a mock intercept in one overload of a free function or static member function.
+    //!
+    //! Example usage:
+    //! \code
+    //! double Scale(double x)
+    //! {
+    //!     NVM_FUNCTION_OVERLOAD_INTERCEPT(Scale, double(double), x);
+    //!     return 2 * x;
+    //! }
+    //! \endcode
+    #define NVM_FUNCTION_OVERLOAD_INTERCEPT(Function, Signature, ...)                \
+        NVM_DETAIL_FUNCTION_INTERCEPT(Signature                                      \
+          , static_cast<NVM_TYPENAME nvm::detail::function_ptr<Signature>::type>(&Function)\
+          , BOOST_PP_STRINGIZE(Function)                                             \
+          , __VA_ARGS__)                                                             \
+    /***/
+
+    //! \def NVM_IMPLEMENT_MOCKABLE
+    //! \brief This macro can be used instead of inheriting from mockable to provide a non-virtual mechanism for checking if a type is mocked.
+    //! Simply place this macro in the class definition instead of inheriting from mockable.
+    //! NOTE: get_mock_mem_fn is a virtual member function and so adding this macro will
+    //! render a type as polymorphic. This will break POD-ness.
+    //! Example usage:
+    //! \code
+    //! class MyClass
+    //! {
+    //! public:
+    //!     MyClass();
+    //!     ~MyClass();
+    //! 
+    //!     NVM_IMPLEMENT_MOCKABLE();
+    //! };
+    //! \endcode
+    #define NVM_IMPLEMENT_MOCKABLE()                                           \
+        typedef void ImplementsMockable;                                       \
+        struct mockable                                                        \
+        {                                                                      \
+            mockable() : is_mocked(false) {}                                   \
+            bool is_mocked;                                                    \
+        } BOOST_PP_CAT(m_mockState, __LINE__);                                 \
+        bool is_mocked() const                                                 \
+        {                                                                      \
+            return BOOST_PP_CAT(m_mockState, __LINE__).is_mocked;              \
+        }                                                                      \
+        void set_is_mocked(bool v)                                             \
+        {                                                                      \
+            BOOST_PP_CAT(m_mockState, __LINE__).is_mocked = v;                 \
+        }                                                                      \
+        virtual const nvm::mock_function_base* get_mock_mem_fn                 \
+        (const nvm::mock_site& site) const                                     \
+        { return 0; }                                                          \
+    /***/
+#else
+    #define NVM_MOCK_INTERCEPT(Method, Signature, ...)
+    #define NVM_MOCK_INTERCEPT_SIG(Method, Signature, ...)  
+    #define NVM_MOCK_OVERLOAD_INTERCEPT(T, Method, Sig, ...)  
+    #define NVM_MOCK_OVERLOAD_CONST_INTERCEPT(T, Method, Sig, ...) 
+    #define NVM_FUNCTION_INTERCEPT(Function, ...)
+    #define NVM_FUNCTION_OVERLOAD_INTERCEPT(Function, Signature, ...)
+    #define NVM_IMPLEMENT_MOCKABLE()
+#endif
+
+#endif // NVM_INTERCEPT_HPP
@@ -10,15 +10,69 @@
 #define NVM_MEMBERFUNCTIONTRAITS_HPP
 #pragma once
 
+#include "detail/config.hpp"
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+#include <utility>
+
+template <typename F>
+struct signature_of_mem_fn;
+
+template <typename R, typename T, typename... Args>
+struct signature_of_mem_fn<R (T::*)(Args...)>
+{
+    typedef R type(Args...);
+};
+
+template <typename R, typename T, typename... Args>
+struct signature_of_mem_fn<R (T::*)(Args...) const>
+{
+    typedef R type(Args...);
+};
+
+namespace nvm
+{
+    //! The number of parameters of a member function pointer type, counting the implicit object parameter.
+    template <typename F>
+    struct mem_fn_arity;
+
+    template <typename R, typename T, typename... Args>
+    struct mem_fn_arity<R (T::*)(Args...)>
+    {
+        static const unsigned int value = sizeof...(Args) + 1;
+    };
+
+    template <typename R, typename T, typename... Args>
+    struct mem_fn_arity<R (T::*)(Args...) const>
+    {
+        static const unsigned int value = sizeof...(Args) + 1;
+    };
+
+    //! Member function pointer types of a given signature; used to select overloads.
+    template <typename Signature>
+    struct mem_fn_ptr_gen;
+
+    template <typename R, typename... Args>
+    struct mem_fn_ptr_gen<R(Args...)>
+    {
+        template <typename T>
+        struct apply
+        {
+            typedef R (T::*type)(Args...);
+            typedef R (T::*const_type)(Args...) const;
+        };
+    };
+}//! namespace nvm;
+
+#else
 #include <boost/mpl/pop_front.hpp>
 #include <boost/mpl/push_front.hpp>
 #include <boost/mpl/identity.hpp>
 #include <boost/function_types/is_member_function_pointer.hpp>
 #include <boost/function_types/function_type.hpp>
+#include <boost/function_types/function_arity.hpp>
 #include <boost/function_types/result_type.hpp>
 #include <boost/function_types/parameter_types.hpp>
-#include <boost/typeof/typeof.hpp>
-#include "detail/member_function_traits.hpp"
 
 template <typename F>
 struct signature_of_mem_fn
@@ -30,4 +84,16 @@ struct signature_of_mem_fn
     typedef typename boost::function_types::function_type<L>::type type;
 };
 
+namespace nvm
+{
+    //! The number of parameters of a member function pointer type, counting the implicit object parameter.
+    template <typename F>
+    struct mem_fn_arity : boost::function_types::function_arity<F>
+    {};
+}//! namespace nvm;
+
+#endif// NVM_HAS_VARIADIC_TEMPLATES
+
+#include "detail/member_function_traits.hpp"
+
 #endif // NVM_MEMBERFUNCTIONTRAITS_HPP
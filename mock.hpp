@@ -12,10 +12,17 @@
 
 #include "mock_base.hpp"
 #include "mockable.hpp"
+#include "mock_table.hpp"
+#include "function_mock.hpp"
+#include "scoped_override.hpp"
 #include "detail/thread/once_block.hpp"
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/is_base_and_derived.hpp>
 #include <boost/preprocessor/repetition/enum_params.hpp>
 #include <boost/preprocessor/repetition/enum_binary_params.hpp>
 #include <boost/preprocessor/iteration/local.hpp>
+#include <typeinfo>
+#include <utility>
 
 #if !defined(NVM_MAX_MOCK_PARAMS)
     #define NVM_MAX_MOCK_PARAMS 10
@@ -39,8 +46,8 @@ namespace nvm
 
 #if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
         template <typename... Args>
-        mock(Args... args)
-            : T(args...)
+        mock(Args&&... args)
+            : T(std::forward<Args>(args)...)
         {}
 #else
         mock()
@@ -61,13 +68,9 @@ namespace nvm
 		
 		bool is_mocked() const { return true; }
 
-        virtual boost::shared_ptr<boost::function_base> get_mock_mem_fn(const std::string& signature) const
+        virtual const mock_function_base* get_mock_mem_fn(const mock_site& site) const
         {
-            boost::shared_ptr<mocker> pMocker = mock_base::get_mocker(signature);
-            if (!pMocker)
-                return boost::shared_ptr<boost::function_base>();
-            else
-                return pMocker->operator()((void*)this);
+            return mock_base::get_bound_mocker(site, (void*)this, typeid(*this));
         }
     };
 
@@ -79,8 +82,8 @@ namespace nvm
 
 #if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
         template <typename... Args>
-        mock(Args... args)
-            : T(args...)
+        mock(Args&&... args)
+            : T(std::forward<Args>(args)...)
         {
             T::set_is_mocked(true);
         }
@@ -105,13 +108,9 @@ namespace nvm
 
         virtual ~mock(){}
 
-        virtual boost::shared_ptr<boost::function_base> get_mock_mem_fn(const std::string& signature) const
+        virtual const mock_function_base* get_mock_mem_fn(const mock_site& site) const
         {
-            boost::shared_ptr<mocker> pMocker = mock_base::get_mocker(signature);
-            if (!pMocker)
-                return boost::shared_ptr<boost::function_base>();
-            else
-                return pMocker->operator()((void*)this);
+            return mock_base::get_bound_mocker(site, (void*)this, typeid(*this));
         }
     };
 
@@ -11,23 +11,46 @@
 #pragma once
 
 #include "mockable.hpp"
-#include <boost/function_types/function_arity.hpp>
-#include <boost/container/flat_map.hpp>
-
-namespace boost { class function_base; }
+#include "detail/mock_fn_cache.hpp"
+#include "detail/mock_type_dispatch.hpp"
+#include <typeinfo>
 
 namespace nvm
 {
+    template <typename MockType>
+    class mock_table_builder;
+
     struct mock_base
     {
-        struct mocker
+        typedef nvm::mocker mocker;
+
+        template <typename MockType>
+        friend class mock_table_builder;
+
+        //! Every live mock holds the process wide intercept gate open.
+        //! A mock dispatches through the mock_context bound to the thread which constructed it.
+        mock_base()
+            : m_pContext(detail::current_context())
+            , m_pTable(0)
         {
-            virtual boost::shared_ptr<boost::function_base> operator()(void* pThis) const = 0;
-        };
+            detail::live_mock_count().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        mock_base(const mock_base&)
+            : m_pContext(detail::current_context())
+            , m_pTable(0)
+        {
+            detail::live_mock_count().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //! Virtual so that the registrations of a mock type can be matched to instances with dynamic_cast.
+        virtual ~mock_base()
+        {
+            detail::live_mock_count().fetch_sub(1, std::memory_order_relaxed);
+        }
+
     private:
 
-        typedef boost::container::flat_map < std::string, boost::shared_ptr<mocker> > mocker_map;
-        
         template <typename T, typename Original, typename Mocked>
         struct mocker_impl : mocker
         {
@@ -39,43 +62,56 @@ namespace nvm
             Original o;
             Mocked m;
 
-            boost::shared_ptr<boost::function_base> operator()(void* pThis) const
+            boost::shared_ptr<mock_function_base> operator()(void* pThis) const
             {
                 return nvm::mock_base::make_mocked(o, m, static_cast<T*>(pThis));
             }
         };
 
-		static mocker_map& get_mocker_map_instance()
-        {
-			//! FIXME:? Not thread safe... may bloat as well due to multiple modules.
-			static mocker_map s_mockers;
-			return s_mockers;
-		}
-
     protected:
 
-        static boost::shared_ptr<mocker> get_mocker(const std::string& signature)
+        mocker* get_mocker(const mock_site& site) const
         {
-			mocker_map& s_mockers = get_mocker_map_instance();
-            mocker_map::const_iterator it(s_mockers.find(signature));
-            if (it == s_mockers.end())
-                return boost::shared_ptr<mocker>();
-            else
-                return it->second;
+            return detail::get_mocker(site, m_pContext);
+        }
+
+        //! Get the mocked callable for a site bound to this mock instance.
+        //! The callable is bound on the first call and cached for the lifetime of the instance.
+        //! \param type is the dynamic type of the instance, whose dispatch table is resolved on the first call,
+        //! without a lock once another instance of the type has resolved it. The table holds the registrations
+        //! of the type and of the registering mock types it derives from, so an instance dispatches only to
+        //! mockers registered for what it is.
+        const mock_function_base* get_bound_mocker(const mock_site& site, void* pThis, const std::type_info& type) const
+        {
+            detail::mock_type_table* pTable = m_pTable.load(std::memory_order_acquire);
+            if (!pTable)
+            {
+                pTable = &detail::mock_type_registry::instance().get_table(type);
+                m_pTable.store(pTable, std::memory_order_release);
+            }
+            const mock_site* pSite = pTable->find_site(site);
+            if (!pSite && detail::mock_type_registry::instance().refresh(*pTable, this))
+                pSite = pTable->find_site(site);
+            return pSite ? m_boundMockers.get(*pSite, pThis, m_pContext) : 0;
         }
 
         template <typename T, typename OriginalMFN, typename MockMFN>
         static void register_mocker(OriginalMFN o, MockMFN m, const std::string& mfName)
         {
-			mocker_map& s_mockers = get_mocker_map_instance();
-            s_mockers[get_mock_mem_fn_key(o, mfName)] = boost::make_shared< mocker_impl<T, OriginalMFN, MockMFN> >(o, m);
+            detail::set_mock_type_mocker<T>(get_mock_site(o, mfName), boost::make_shared< mocker_impl<T, OriginalMFN, MockMFN> >(o, m));
         }
 
         template <typename OriginalMFN, typename MockMFN, typename T>
-        static boost::shared_ptr<boost::function_base> make_mocked(OriginalMFN opMFN, MockMFN mpMFN, T* pThis)
+        static boost::shared_ptr<mock_function_base> make_mocked(OriginalMFN opMFN, MockMFN mpMFN, T* pThis)
         {
-            return mock_function_factory< boost::function_types::function_arity<OriginalMFN>::value >::create(opMFN, mpMFN, pThis);
+            return mock_function_factory< mem_fn_arity<OriginalMFN>::value >::create(opMFN, mpMFN, pThis);
         }
+
+    private:
+
+        detail::context_dispatch*                                   m_pContext;
+        mutable std::atomic<detail::mock_type_table*>               m_pTable;
+        mutable detail::mock_fn_cache                               m_boundMockers;
     };
 
 }//! namespace nvm;
@@ -10,11 +10,15 @@
 #define NVM_MOCKFUNCTIONFACTORY_HPP
 #pragma once
 
-#include <boost/bind.hpp>
+#include "member_function_traits.hpp"
+#include "detail/mocker_registry.hpp"
+#include "detail/mock_function.hpp"
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
-#include <boost/function.hpp>
-#include "member_function_traits.hpp"
+#if !defined(NVM_HAS_VARIADIC_TEMPLATES)
+#include <boost/bind.hpp>
+#endif
+
 #include "detail/mock_function_factory.hpp"
 
 #endif // NVM_MOCKFUNCTIONFACTORY_HPP
@@ -0,0 +1,252 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_MOCKPOOL_HPP
+#define NVM_MOCKPOOL_HPP
+#pragma once
+
+#include "mock.hpp"
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/enum_binary_params.hpp>
+#include <boost/preprocessor/iteration/local.hpp>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! \def NVM_MOCK_POOL_CHUNK_SIZE
+//! \brief The default number of mocks allocated together by a mock_pool.
+#if !defined(NVM_MOCK_POOL_CHUNK_SIZE)
+    #define NVM_MOCK_POOL_CHUNK_SIZE 1024
+#endif
+
+namespace nvm
+{
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class mock_pool
+    //! \brief Constructs mocks of type Mock in storage allocated a chunk at a time and reused.
+    //! create forwards its arguments to Mock's constructor (and so to the mocked type's constructor). destroy
+    //! runs the mock's destructor and keeps its storage for the next create, and clear does so for every live
+    //! mock, so repeated test iterations construct their mocks without allocating. Only the pool's own storage
+    //! is pooled; allocations made by the mock itself (e.g. gmock expectations) are not.
+    //! A mock_pool is not synchronized; use one per thread or lock around it.
+    //!
+    //! Example usage:
+    //! \code
+    //! nvm::mock_pool<MockNode> nodes;
+    //! for (int iteration = 0; iteration < n; ++iteration)
+    //! {
+    //!     std::vector<MockNode*> graph;
+    //!     nodes.create_n(100000, graph, "node");
+    //!     ...
+    //!     nodes.clear();
+    //! }
+    //! \endcode
+    template <typename Mock>
+    class mock_pool : boost::noncopyable
+    {
+        struct slot
+        {
+            typename std::aligned_storage<sizeof(Mock), std::alignment_of<Mock>::value>::type storage;
+            slot* pNextFree;
+            bool  live;
+        };
+
+    public:
+
+        explicit mock_pool(std::size_t chunkSize = NVM_MOCK_POOL_CHUNK_SIZE)
+            : m_chunkSize(chunkSize ? chunkSize : 1)
+            , m_pFree(0)
+            , m_used(0)
+            , m_size(0)
+        {}
+
+        ~mock_pool()
+        {
+            clear();
+            for (std::size_t i = 0; i < m_chunks.size(); ++i)
+                delete [] m_chunks[i];
+        }
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+        template <typename... Args>
+        Mock* create(Args&&... args)
+        {
+            slot* pSlot = acquire();
+            try
+            {
+                ::new (&pSlot->storage) Mock(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                release(pSlot);
+                throw;
+            }
+            return activate(pSlot);
+        }
+
+        //! Appends n mocks constructed from the same arguments to mocks. Each construction is passed the
+        //! arguments as lvalues as they are used more than once.
+        template <typename... Args>
+        void create_n(std::size_t n, std::vector<Mock*>& mocks, Args&&... args)
+        {
+            reserve(m_size + n);
+            mocks.reserve(mocks.size() + n);
+            for (std::size_t i = 0; i < n; ++i)
+                mocks.push_back(create(args...));
+        }
+#else
+        Mock* create()
+        {
+            slot* pSlot = acquire();
+            try
+            {
+                ::new (&pSlot->storage) Mock();
+            }
+            catch (...)
+            {
+                release(pSlot);
+                throw;
+            }
+            return activate(pSlot);
+        }
+
+        void create_n(std::size_t n, std::vector<Mock*>& mocks)
+        {
+            reserve(m_size + n);
+            mocks.reserve(mocks.size() + n);
+            for (std::size_t i = 0; i < n; ++i)
+                mocks.push_back(create());
+        }
+
+        #define BOOST_PP_LOCAL_MACRO(n)                                            \
+        template <BOOST_PP_ENUM_PARAMS(n, typename A)>                             \
+        Mock* create(BOOST_PP_ENUM_BINARY_PARAMS(n, const A, &a))                  \
+        {                                                                          \
+            slot* pSlot = acquire();                                               \
+            try                                                                    \
+            {                                                                      \
+                ::new (&pSlot->storage) Mock(BOOST_PP_ENUM_PARAMS(n, a));          \
+            }                                                                      \
+            catch (...)                                                            \
+            {                                                                      \
+                release(pSlot);                                                    \
+                throw;                                                             \
+            }                                                                      \
+            return activate(pSlot);                                                \
+        }                                                                          \
+        template <BOOST_PP_ENUM_PARAMS(n, typename A)>                             \
+        void create_n(std::size_t count, std::vector<Mock*>& mocks                 \
+                    , BOOST_PP_ENUM_BINARY_PARAMS(n, const A, &a))                 \
+        {                                                                          \
+            reserve(m_size + count);                                               \
+            mocks.reserve(mocks.size() + count);                                   \
+            for (std::size_t i = 0; i < count; ++i)                                \
+                mocks.push_back(create(BOOST_PP_ENUM_PARAMS(n, a)));               \
+        }                                                                          \
+        /***/
+
+        #define BOOST_PP_LOCAL_LIMITS (1, NVM_MAX_MOCK_PARAMS)
+        #include BOOST_PP_LOCAL_ITERATE()
+#endif
+
+        //! Destroys a mock created by this pool and keeps its storage for reuse.
+        void destroy(Mock* pMock)
+        {
+            slot* pSlot = reinterpret_cast<slot*>(pMock);
+            BOOST_ASSERT(pSlot->live);
+            pMock->~Mock();
+            release(pSlot);
+        }
+
+        //! Destroys every live mock. The storage is kept, so the next batch is constructed without allocating.
+        void clear()
+        {
+            for (std::size_t c = 0; c < m_chunks.size() && m_size; ++c)
+            {
+                slot* pChunk = m_chunks[c];
+                for (std::size_t i = 0; i < m_chunkSize && m_size; ++i)
+                {
+                    if (pChunk[i].live)
+                        destroy(reinterpret_cast<Mock*>(&pChunk[i].storage));
+                }
+            }
+        }
+
+        //! Allocates storage for at least n mocks.
+        void reserve(std::size_t n)
+        {
+            while (m_chunks.size() * m_chunkSize < n)
+                add_chunk();
+        }
+
+        //! The number of live mocks.
+        std::size_t size() const { return m_size; }
+
+        //! The number of mocks the pool can hold without allocating.
+        std::size_t capacity() const { return m_chunks.size() * m_chunkSize; }
+
+    private:
+
+        void add_chunk()
+        {
+            //! Owned until it is in m_chunks, in case growing m_chunks throws.
+            std::unique_ptr<slot[]> pChunk(new slot[m_chunkSize]);
+            for (std::size_t i = 0; i < m_chunkSize; ++i)
+                pChunk[i].live = false;
+            m_chunks.push_back(pChunk.get());
+            pChunk.release();
+        }
+
+        //! Freed slots are reused first; otherwise slots are handed out in order through the chunks.
+        slot* acquire()
+        {
+            if (slot* pSlot = m_pFree)
+            {
+                m_pFree = pSlot->pNextFree;
+                return pSlot;
+            }
+            if (m_used == capacity())
+                add_chunk();
+            slot* pSlot = m_chunks[m_used / m_chunkSize] + m_used % m_chunkSize;
+            ++m_used;
+            return pSlot;
+        }
+
+        Mock* activate(slot* pSlot)
+        {
+            pSlot->live = true;
+            ++m_size;
+            return reinterpret_cast<Mock*>(&pSlot->storage);
+        }
+
+        void release(slot* pSlot)
+        {
+            if (pSlot->live)
+            {
+                pSlot->live = false;
+                --m_size;
+            }
+            pSlot->pNextFree = m_pFree;
+            m_pFree = pSlot;
+        }
+
+        std::size_t         m_chunkSize;
+        std::vector<slot*>  m_chunks;
+        slot*               m_pFree;
+        std::size_t         m_used;
+        std::size_t         m_size;
+    };
+
+}//! namespace nvm;
+
+#endif // NVM_MOCKPOOL_HPP
@@ -0,0 +1,153 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_MOCKTABLE_HPP
+#define NVM_MOCKTABLE_HPP
+#pragma once
+
+//! Declarative mock registration.
+//! A mock table lists the member functions a mock type redirects. It is loaded during static initialization
+//! of the translation unit which declares it, in one batch: the sites are resolved with a single sorted
+//! insert into the registry and the mockers are published under one lock. Mocks whose registrations are
+//! in a table need no NVM_ONCE_BLOCK in their constructor, so constructing one costs only the object.
+//! Table entries apply in every mock_context. A mocker registered at run time (NVM_REGISTER_MOCK_*, in the
+//! process wide registry or in a context) takes precedence over the table entry for the same site.
+//!
+//! Example usage (at namespace scope, after the mock type is complete):
+//! \code
+//! NVM_BEGIN_MOCK_TABLE(MockA)
+//!     NVM_MOCK_TABLE_MEMBER_FUNCTION(A, SomeFn)
+//!     NVM_MOCK_TABLE_OVERLOADED_MEMBER_FUNCTION(A, OverloadedFn, void(int, double))
+//!     NVM_MOCK_TABLE_OVERLOADED_CONST_MEMBER_FUNCTION(A, OverloadedFn, bool(char, double))
+//! NVM_END_MOCK_TABLE()
+//! \endcode
+#include "mock_base.hpp"
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nvm
+{
+    //! \class mock_table_builder
+    //! \brief Collects the entries of MockType's mock table and loads them into the registry.
+    template <typename MockType>
+    class mock_table_builder
+    {
+        typedef std::pair<std::string, std::string>         key_name;
+        typedef std::pair< key_name, boost::shared_ptr<mocker> > entry;
+
+        struct key_less
+        {
+            bool operator()(const entry& lhs, const entry& rhs) const { return lhs.first.first < rhs.first.first; }
+        };
+
+    public:
+
+        typedef MockType mock_type;
+
+        template <typename OriginalMFN, typename MockMFN>
+        void add(OriginalMFN o, MockMFN m, const std::string& mfName)
+        {
+            typedef mock_base::mocker_impl<MockType, OriginalMFN, MockMFN> mocker_type;
+            m_entries.push_back(entry(key_name(get_mock_mem_fn_key(o, mfName), mfName), boost::make_shared<mocker_type>(o, m)));
+        }
+
+        //! Resolves every site in one batch and publishes the table's mockers.
+        void load()
+        {
+            //! A later entry for the same site replaces an earlier one, as with repeated registrations.
+            std::stable_sort(m_entries.begin(), m_entries.end(), key_less());
+            std::vector<key_name> keys;
+            std::vector< boost::shared_ptr<mocker> > mockers;
+            keys.reserve(m_entries.size());
+            mockers.reserve(m_entries.size());
+            for (std::size_t i = 0; i < m_entries.size(); ++i)
+            {
+                keys.push_back(m_entries[i].first);
+                mockers.push_back(m_entries[i].second);
+            }
+
+            std::vector<mock_site*> sites;
+            detail::site_registry::instance().get_sites(keys, sites);
+            std::vector<mock_site*> typedSites;
+            detail::get_mock_type_dispatch<MockType>().get_sites(sites, typedSites);
+            detail::mocker_registry::instance().set_table_mockers(typedSites, mockers);
+            m_entries.clear();
+        }
+
+    private:
+
+        std::vector<entry> m_entries;
+    };
+
+    namespace detail
+    {
+        //! Loads a mock table during static initialization.
+        template <typename MockType>
+        struct mock_table_registrar
+        {
+            explicit mock_table_registrar(void (*fill)(mock_table_builder<MockType>&))
+            {
+                mock_table_builder<MockType> builder;
+                fill(builder);
+                builder.load();
+            }
+        };
+
+    }//! namespace detail;
+}//! namespace nvm;
+
+//! \def NVM_BEGIN_MOCK_TABLE( MockType )
+//! \brief Begins the mock table of MockType. Use at namespace scope and close with NVM_END_MOCK_TABLE.
+#define NVM_BEGIN_MOCK_TABLE(MockType)                                                                     \
+    static void BOOST_PP_CAT(nvm_fill_mock_table_, __LINE__)(nvm::mock_table_builder< MockType >&);        \
+    static const nvm::detail::mock_table_registrar< MockType >                                             \
+        BOOST_PP_CAT(nvm_mock_table_registrar_, __LINE__)(&BOOST_PP_CAT(nvm_fill_mock_table_, __LINE__));  \
+    static void BOOST_PP_CAT(nvm_fill_mock_table_, __LINE__)(nvm::mock_table_builder< MockType >& nvm_table)\
+    {                                                                                                      \
+        typedef MockType nvm_mock_type;                                                                    \
+/***/
+
+//! \def NVM_END_MOCK_TABLE()
+//! \brief Ends a mock table begun with NVM_BEGIN_MOCK_TABLE.
+#define NVM_END_MOCK_TABLE()                                                                               \
+    }                                                                                                      \
+/***/
+
+//! \def NVM_MOCK_TABLE_MEMBER_FUNCTION( OriginalType, MemberFn )
+//! \brief Redirects OriginalType::MemberFn to the mock type's MemberFn.
+#define NVM_MOCK_TABLE_MEMBER_FUNCTION(OriginalType, MemberFn)                                             \
+    nvm_table.add(&OriginalType::MemberFn, &nvm_mock_type::MemberFn, BOOST_PP_STRINGIZE(OriginalType::MemberFn));\
+/***/
+
+//! \def NVM_MOCK_TABLE_OVERLOADED_MEMBER_FUNCTION( OriginalType, MemberFn, Signature )
+//! \brief Redirects one overload of a non-const OriginalType::MemberFn to the mock type's MemberFn.
+#define NVM_MOCK_TABLE_OVERLOADED_MEMBER_FUNCTION(OriginalType, MemberFn, Signature)                       \
+    nvm_table.add                                                                                          \
+    (                                                                                                      \
+        static_cast<nvm::mem_fn_ptr_gen<Signature>::template apply<OriginalType>::type>(&OriginalType::MemberFn)\
+      , static_cast<nvm::mem_fn_ptr_gen<Signature>::template apply<nvm_mock_type>::type>(&nvm_mock_type::MemberFn)\
+      , BOOST_PP_STRINGIZE(OriginalType::MemberFn)                                                         \
+    );                                                                                                     \
+/***/
+
+//! \def NVM_MOCK_TABLE_OVERLOADED_CONST_MEMBER_FUNCTION( OriginalType, MemberFn, Signature )
+//! \brief Redirects one overload of a const OriginalType::MemberFn to the mock type's MemberFn.
+#define NVM_MOCK_TABLE_OVERLOADED_CONST_MEMBER_FUNCTION(OriginalType, MemberFn, Signature)                 \
+    nvm_table.add                                                                                          \
+    (                                                                                                      \
+        static_cast<nvm::mem_fn_ptr_gen<Signature>::template apply<OriginalType>::const_type>(&OriginalType::MemberFn)\
+      , static_cast<nvm::mem_fn_ptr_gen<Signature>::template apply<nvm_mock_type>::const_type>(&nvm_mock_type::MemberFn)\
+      , BOOST_PP_STRINGIZE(OriginalType::MemberFn)                                                         \
+    );                                                                                                     \
+/***/
+
+#endif // NVM_MOCKTABLE_HPP
@@ -0,0 +1,261 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_PARALLELTEST_HPP
+#define NVM_PARALLELTEST_HPP
+#pragma once
+
+//! Google Test cases which run in parallel within one process.
+//! Cases declared with NVM_PARALLEL_TEST each run in a fresh mock_context, so cases which register different
+//! mocks for the same member functions do not interfere. Call nvm::register_parallel_tests from main after
+//! InitGoogleTest and before RUN_ALL_TESTS.
+#include "mock.hpp"
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace nvm
+{
+    //! \class parallel_tests
+    //! \brief The cases declared with NVM_PARALLEL_TEST.
+    class parallel_tests
+    {
+    public:
+
+        typedef void (*test_fn)();
+
+        struct test_case
+        {
+            const char* suite;
+            const char* name;
+            const char* file;
+            int         line;
+            test_fn     fn;
+        };
+
+        static parallel_tests& instance()
+        {
+            static parallel_tests s_instance;
+            return s_instance;
+        }
+
+        bool add(const char* suite, const char* name, const char* file, int line, test_fn fn)
+        {
+            test_case c = { suite, name, file, line, fn };
+            m_cases.push_back(c);
+            return true;
+        }
+
+        const std::vector<test_case>& cases() const { return m_cases; }
+
+    private:
+
+        std::vector<test_case> m_cases;
+    };
+
+    namespace detail
+    {
+        inline void run_in_own_context(parallel_tests::test_fn fn)
+        {
+            mock_context context;
+            scoped_mock_context bind(context);
+            fn();
+        }
+
+        class isolated_test : public ::testing::Test
+        {
+        public:
+
+            explicit isolated_test(parallel_tests::test_fn fn)
+                : m_fn(fn)
+            {}
+
+            void TestBody() { run_in_own_context(m_fn); }
+
+        private:
+
+            parallel_tests::test_fn m_fn;
+        };
+
+        //! What one case reported while running on a worker thread.
+        struct parallel_case_result
+        {
+            ::testing::TestPartResultArray parts;
+            std::string                    exception;
+        };
+
+        //! \class parallel_run
+        //! \brief Runs the selected cases on a pool of threads the first time any of their tests runs.
+        //! The assertions of each case are captured on its worker thread and an exception is caught there rather
+        //! than terminating the process; the case's own test then reports them (see parallel_case_test).
+        class parallel_run : boost::noncopyable
+        {
+        public:
+
+            static parallel_run& instance()
+            {
+                static parallel_run s_instance;
+                return s_instance;
+            }
+
+            const parallel_case_result& get_result(std::size_t index, std::size_t threads)
+            {
+                std::call_once(m_once, [this, threads]() { run(threads); });
+                return *m_results[index];
+            }
+
+        private:
+
+            void run(std::size_t threads)
+            {
+                const std::vector<parallel_tests::test_case>& cases = parallel_tests::instance().cases();
+                std::set< std::pair<std::string, std::string> > selected;
+                const ::testing::UnitTest& unitTest = *::testing::UnitTest::GetInstance();
+                for (int s = 0; s < unitTest.total_test_suite_count(); ++s)
+                {
+                    const ::testing::TestSuite& suite = *unitTest.GetTestSuite(s);
+                    for (int t = 0; t < suite.total_test_count(); ++t)
+                    {
+                        if (suite.GetTestInfo(t)->should_run())
+                            selected.insert(std::make_pair(std::string(suite.name()), std::string(suite.GetTestInfo(t)->name())));
+                    }
+                }
+
+                std::vector<std::size_t> indices;
+                for (std::size_t i = 0; i < cases.size(); ++i)
+                {
+                    m_results.push_back(boost::make_shared<parallel_case_result>());
+                    if (selected.count(std::make_pair(std::string(cases[i].suite), std::string(cases[i].name))))
+                        indices.push_back(i);
+                }
+
+                std::atomic<std::size_t> next(0);
+                std::vector<std::thread> workers;
+                for (std::size_t t = 0; t < threads; ++t)
+                {
+                    workers.push_back(std::thread([&]()
+                    {
+                        for (std::size_t k; (k = next.fetch_add(1)) < indices.size();)
+                        {
+                            parallel_case_result& result = *m_results[indices[k]];
+                            ::testing::ScopedFakeTestPartResultReporter reporter(::testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, &result.parts);
+                            try
+                            {
+                                run_in_own_context(cases[indices[k]].fn);
+                            }
+                            catch (const std::exception& e)
+                            {
+                                result.exception = e.what();
+                            }
+                            catch (...)
+                            {
+                                result.exception = "an unknown exception";
+                            }
+                        }
+                    }));
+                }
+                for (std::size_t t = 0; t < workers.size(); ++t)
+                    workers[t].join();
+            }
+
+            std::once_flag                                          m_once;
+            std::vector< boost::shared_ptr<parallel_case_result> >  m_results;
+        };
+
+        //! The test of one case run by parallel_run. The first such test to run waits for every selected case,
+        //! so the elapsed time of the whole run is reported against it.
+        class parallel_case_test : public ::testing::Test
+        {
+        public:
+
+            parallel_case_test(std::size_t index, std::size_t threads)
+                : m_index(index)
+                , m_threads(threads)
+            {}
+
+            void TestBody()
+            {
+                const parallel_case_result& result = parallel_run::instance().get_result(m_index, m_threads);
+                for (int i = 0; i < result.parts.size(); ++i)
+                {
+                    const ::testing::TestPartResult& part = result.parts.GetTestPartResult(i);
+                    if (part.failed())
+                        ADD_FAILURE_AT(part.file_name() ? part.file_name() : "unknown file", part.line_number()) << part.message();
+                }
+
+                if (!result.exception.empty())
+                {
+                    const parallel_tests::test_case& c = parallel_tests::instance().cases()[m_index];
+                    ADD_FAILURE_AT(c.file, c.line) << c.suite << "." << c.name << " threw " << result.exception;
+                }
+            }
+
+        private:
+
+            std::size_t m_index;
+            std::size_t m_threads;
+        };
+
+    }//! namespace detail;
+
+    //! \brief Registers the NVM_PARALLEL_TEST cases with Google Test, each as its own test.
+    //! With one thread each case runs serially in its own context when its test runs. With more threads (0 means
+    //! one per hardware thread) the first case's test runs every selected case on that many threads and each test
+    //! reports the failures, and any exception, of its own case.
+    inline void register_parallel_tests(std::size_t threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        const std::vector<parallel_tests::test_case>& cases = parallel_tests::instance().cases();
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            parallel_tests::test_fn fn = cases[i].fn;
+            if (threads == 1)
+                ::testing::RegisterTest(cases[i].suite, cases[i].name, 0, 0, cases[i].file, cases[i].line, [fn]() -> ::testing::Test* { return new detail::isolated_test(fn); });
+            else
+                ::testing::RegisterTest(cases[i].suite, cases[i].name, 0, 0, cases[i].file, cases[i].line, [i, threads]() -> ::testing::Test* { return new detail::parallel_case_test(i, threads); });
+        }
+    }
+
+}//! namespace nvm;
+
+//! \def NVM_PARALLEL_TEST(Suite, Name)
+//! \brief Declares a test case which may run concurrently with other such cases in its own mock_context.
+//! Example usage:
+//! \code
+//! NVM_PARALLEL_TEST(PricerTests, PricesFromMockedFeed)
+//! {
+//!     MockFeed feed;
+//!     EXPECT_CALL(feed, Quote(_)).WillRepeatedly(Return(1.0));
+//!     ...
+//! }
+//! \endcode
+#define NVM_PARALLEL_TEST(Suite, Name)                                                                                         \
+    static void BOOST_PP_CAT(nvm_parallel_test_, BOOST_PP_CAT(Suite, BOOST_PP_CAT(_, Name)))();                                \
+    static const bool BOOST_PP_CAT(nvm_parallel_test_registered_, BOOST_PP_CAT(Suite, BOOST_PP_CAT(_, Name))) =                \
+        nvm::parallel_tests::instance().add(BOOST_PP_STRINGIZE(Suite), BOOST_PP_STRINGIZE(Name), __FILE__, __LINE__            \
+          , &BOOST_PP_CAT(nvm_parallel_test_, BOOST_PP_CAT(Suite, BOOST_PP_CAT(_, Name))));                                    \
+    static void BOOST_PP_CAT(nvm_parallel_test_, BOOST_PP_CAT(Suite, BOOST_PP_CAT(_, Name)))()                                 \
+/***/
+
+#endif // NVM_PARALLELTEST_HPP
@@ -0,0 +1,115 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_SCOPEDOVERRIDE_HPP
+#define NVM_SCOPEDOVERRIDE_HPP
+#pragma once
+
+#include "mockable.hpp"
+#include "detail/thread/thread_overrides.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/type_traits/is_member_function_pointer.hpp>
+#include <boost/type_traits/remove_pointer.hpp>
+
+namespace nvm
+{
+    namespace detail
+    {
+        //! The signature of an intercepted member function, or free or static member function, pointer type.
+        template <typename F, bool IsMemberFunction = boost::is_member_function_pointer<F>::value>
+        struct override_signature
+        {
+            typedef typename signature_of_mem_fn<F>::type type;
+        };
+
+        template <typename F>
+        struct override_signature<F, false>
+        {
+            typedef typename boost::remove_pointer<F>::type type;
+        };
+
+    }//! namespace detail;
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class scoped_override
+    //! \brief Redirects one intercepted member function (or free or static member function intercepted with
+    //! NVM_FUNCTION_INTERCEPT) to a callable on the calling thread only.
+    //! While the override is alive every call to the member function made on the constructing thread,
+    //! on real and mock instances alike, goes to the callable. Other threads are unaffected and do not
+    //! touch any shared state to find out. Overrides nest; the innermost one wins and destroying it
+    //! restores the one it replaced. Overrides must be destroyed on the thread which created them.
+    //! The callable takes the member function's arguments (but not the object).
+    //! Use the NVM_SCOPED_OVERRIDE macros rather than naming the site key directly.
+    template <typename MFN>
+    class scoped_override : boost::noncopyable
+    {
+    public:
+
+        typedef typename detail::override_signature<MFN>::type signature_type;
+
+        template <typename Fn>
+        scoped_override(MFN mfn, const std::string& methodName, Fn fn)
+            : m_fn(fn)
+            , m_id(get_mock_site(mfn, methodName).id())
+            , m_pPrevious(detail::push_thread_override(m_id, &m_fn))
+        {
+            detail::live_mock_count().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ~scoped_override()
+        {
+            detail::pop_thread_override(m_id, &m_fn, m_pPrevious);
+            detail::live_mock_count().fetch_sub(1, std::memory_order_relaxed);
+        }
+
+    private:
+
+        mock_function<signature_type> m_fn;
+        std::size_t                   m_id;
+        const mock_function_base*     m_pPrevious;
+    };
+
+}//! namespace nvm;
+
+//! \def NVM_SCOPED_OVERRIDE( Name, Method, Fn )
+//! \brief Declares a scoped_override variable Name which redirects Method to Fn on this thread.
+//! Example usage:
+//! \code
+//! {
+//!     NVM_SCOPED_OVERRIDE(o, MyClass::MemberFunction, [](int a, double b) { return true; });
+//!     ...
+//! }
+//! \endcode
+#define NVM_SCOPED_OVERRIDE(Name, Method, Fn)                                                                                   \
+    nvm::scoped_override<NVM_TYPEOF(&Method)> Name(&Method, BOOST_PP_STRINGIZE(Method), Fn)                                     \
+/***/
+
+//! \def NVM_SCOPED_OVERLOAD_OVERRIDE( Name, Type, Method, Signature, Fn )
+//! \brief Declares a scoped_override variable Name for an overloaded non-const member function.
+#define NVM_SCOPED_OVERLOAD_OVERRIDE(Name, T, Method, Signature, Fn)                                                           \
+    nvm::scoped_override<nvm::mem_fn_ptr_gen<Signature>::template apply<T>::type>                                               \
+        Name(&T::Method, BOOST_PP_STRINGIZE(T::Method), Fn)                                                                     \
+/***/
+
+//! \def NVM_SCOPED_OVERLOAD_CONST_OVERRIDE( Name, Type, Method, Signature, Fn )
+//! \brief Declares a scoped_override variable Name for an overloaded const member function.
+#define NVM_SCOPED_OVERLOAD_CONST_OVERRIDE(Name, T, Method, Signature, Fn)                                                     \
+    nvm::scoped_override<nvm::mem_fn_ptr_gen<Signature>::template apply<T>::const_type>                                         \
+        Name(&T::Method, BOOST_PP_STRINGIZE(T::Method), Fn)                                                                     \
+/***/
+
+//! \def NVM_SCOPED_FUNCTION_OVERLOAD_OVERRIDE( Name, Function, Signature, Fn )
+//! \brief Declares a scoped_override variable Name for one overload of a free or static member function.
+#define NVM_SCOPED_FUNCTION_OVERLOAD_OVERRIDE(Name, Function, Signature, Fn)                                                     \
+    nvm::scoped_override<nvm::detail::function_ptr<Signature>::type> Name(&Function, BOOST_PP_STRINGIZE(Function), Fn)          \
+/***/
+
+#endif // NVM_SCOPEDOVERRIDE_HPP
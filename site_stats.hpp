@@ -0,0 +1,129 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_SITESTATS_HPP
+#define NVM_SITESTATS_HPP
+#pragma once
+
+//! Dispatch telemetry for intercept sites.
+//! Intercept sites compiled with NVM_ENABLE_SITE_STATS defined count every call, the calls redirected to a
+//! mock or scoped_override, the registry misses (the object is mocked but no mocker is registered for the
+//! member function) and the time spent resolving the mock when one is alive. Counters are kept per thread
+//! and merged when read, so counting never contends. Sites compiled without it carry no counting code.
+#include "detail/site_stats_shard.hpp"
+#include "detail/mock_site.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace nvm
+{
+    //! \struct site_stats
+    //! \brief The counters of one intercept site summed over every thread.
+    struct site_stats
+    {
+        std::size_t   siteId;             //! mock_site::id() of the member function.
+        std::string   name;               //! The member function name as written at the intercept.
+        std::uint64_t calls;              //! Every call through the intercept.
+        std::uint64_t mocked;             //! Calls redirected to a mock or a scoped_override.
+        std::uint64_t misses;             //! Calls on a mocked object with no mocker registered for the site.
+        std::uint64_t lookupNanoseconds;  //! Total time spent resolving the mock while any mock was alive.
+    };
+
+    //! \brief Returns the counters of every site which has been called.
+    inline std::vector<site_stats> collect_site_stats()
+    {
+        std::vector<detail::site_totals> totals = detail::site_stats_registry::instance().totals();
+        std::vector<site_stats> stats;
+        for (std::size_t id = 0; id < totals.size(); ++id)
+        {
+            const detail::site_totals& t = totals[id];
+            if (t.calls == 0 && t.mocked == 0 && t.misses == 0)
+                continue;
+            const mock_site* pSite = detail::site_registry::instance().get_site_by_id(id);
+            site_stats s = { id, pSite ? pSite->name() : "site " + std::to_string(id), t.calls, t.mocked, t.misses, t.lookupNanoseconds };
+            stats.push_back(s);
+        }
+        return stats;
+    }
+
+    namespace detail
+    {
+        inline void write_label_value(std::ostream& os, const std::string& s)
+        {
+            os << '"';
+            for (std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+            {
+                if (*it == '"' || *it == '\\')
+                    os << '\\' << *it;
+                else if (*it == '\n')
+                    os << "\\n";
+                else
+                    os << *it;
+            }
+            os << '"';
+        }
+
+        template <typename Field>
+        inline void write_site_metric(std::ostream& os, const std::vector<site_stats>& stats, const char* metric, const char* help, Field field)
+        {
+            os << "# HELP " << metric << ' ' << help << "\n# TYPE " << metric << " counter\n";
+            for (std::size_t i = 0; i < stats.size(); ++i)
+            {
+                os << metric << "{site=";
+                write_label_value(os, stats[i].name);
+                os << "} " << field(stats[i]) << '\n';
+            }
+        }
+
+        struct site_calls { std::uint64_t operator()(const site_stats& s) const { return s.calls; } };
+        struct site_mocked { std::uint64_t operator()(const site_stats& s) const { return s.mocked; } };
+        struct site_misses { std::uint64_t operator()(const site_stats& s) const { return s.misses; } };
+        struct site_lookup_seconds
+        {
+            std::string operator()(const site_stats& s) const
+            {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.9f", s.lookupNanoseconds / 1e9);
+                return buffer;
+            }
+        };
+    }//! namespace detail;
+
+    //! \brief Writes stats in the Prometheus text exposition format, one counter family per field labelled by site.
+    inline void write_site_stats(std::ostream& os, const std::vector<site_stats>& stats)
+    {
+        detail::write_site_metric(os, stats, "nvm_intercept_calls_total", "Calls through an intercept site.", detail::site_calls());
+        detail::write_site_metric(os, stats, "nvm_intercept_mocked_total", "Calls redirected to a mock or scoped override.", detail::site_mocked());
+        detail::write_site_metric(os, stats, "nvm_intercept_misses_total", "Calls on a mocked object with no mocker registered for the site.", detail::site_misses());
+        detail::write_site_metric(os, stats, "nvm_intercept_lookup_seconds_total", "Time spent resolving mocks at an intercept site.", detail::site_lookup_seconds());
+    }
+
+    //! \brief Writes the current counters to path in the text exposition format (e.g. for a node exporter
+    //! textfile collector). The file is written beside path and renamed over it so scrapers never see a
+    //! partial file.
+    //! \return false if the file could not be written.
+    inline bool write_site_stats_file(const std::string& path)
+    {
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream os(tmpPath.c_str(), std::ios::out | std::ios::trunc);
+            write_site_stats(os, collect_site_stats());
+            os.flush();
+            if (!os)
+                return false;
+        }
+        return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    }
+
+}//! namespace nvm;
+
+#endif // NVM_SITESTATS_HPP
@@ -0,0 +1,95 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+//! The process wide mocker registry and live mock counter used when NVM_SHARED_REGISTRY is defined.
+//! Build this file into one shared library (nvmock_registry) and link every module which mocks or
+//! intercepts against it.
+#if !defined(NVM_SHARED_REGISTRY)
+    #define NVM_SHARED_REGISTRY
+#endif
+#define NVM_REGISTRY_SOURCE
+
+#include "../detail/mock_site.hpp"
+#include "../detail/mocker_registry.hpp"
+#include "../detail/mock_gate.hpp"
+#include "../detail/thread/thread_overrides.hpp"
+#include "../detail/call_trace_buffer.hpp"
+#include "../detail/mock_context.hpp"
+#include "../detail/mock_type_dispatch.hpp"
+#include "../detail/site_stats_shard.hpp"
+#include "../detail/fault_rules.hpp"
+#include "../detail/thread/virtual_scheduler.hpp"
+
+namespace nvm { namespace detail {
+
+    site_registry& site_registry::instance()
+    {
+        static site_registry s_instance;
+        return s_instance;
+    }
+
+    mocker_registry& mocker_registry::instance()
+    {
+        static mocker_registry s_instance;
+        return s_instance;
+    }
+
+    mock_type_registry& mock_type_registry::instance()
+    {
+        static mock_type_registry s_instance;
+        return s_instance;
+    }
+
+    std::atomic<std::size_t> shared_live_mock_count(0);
+
+    call_trace_registry& call_trace_registry::instance()
+    {
+        static call_trace_registry s_instance;
+        return s_instance;
+    }
+
+    std::atomic<bool> shared_call_trace_enabled(false);
+
+    site_stats_registry& site_stats_registry::instance()
+    {
+        static site_stats_registry s_instance;
+        return s_instance;
+    }
+
+    fault_registry& fault_registry::instance()
+    {
+        static fault_registry s_instance;
+        return s_instance;
+    }
+
+    std::atomic<virtual_scheduler*>& active_scheduler()
+    {
+        static std::atomic<virtual_scheduler*> s_pScheduler(0);
+        return s_pScheduler;
+    }
+
+    const mock_function_base* pass_through()
+    {
+        static mock_function_base s_passThrough;
+        return &s_passThrough;
+    }
+
+    context_dispatch*& current_context()
+    {
+        static thread_local context_dispatch* t_pContext = 0;
+        return t_pContext;
+    }
+
+    thread_override_table& thread_overrides()
+    {
+        static thread_local thread_override_table t_overrides;
+        return t_overrides;
+    }
+
+}}//! namespace nvm::detail;
@@ -0,0 +1,93 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_STATICMOCK_HPP
+#define NVM_STATICMOCK_HPP
+#pragma once
+
+//! Compile time mock binding.
+//! A class template which takes its mock type as a parameter and derives from static_mockable<Mock> has its
+//! intercepts resolved at compile time: when Mock binds the member function (NVM_STATIC_MOCK_MEMBER_FUNCTION)
+//! the intercept calls the mock's member function directly, so the compiler can inline straight through it,
+//! and otherwise the real implementation runs. No registry, live mock gate or virtual call is involved.
+//! The intercept macros are the same as for runtime mocks. NVM_REGISTER_MOCK_* macros are a compile error in
+//! static mocks, since a registration there could never take effect.
+//!
+//! Example usage:
+//! \code
+//! template <typename Mock = void>
+//! class KernelT : public nvm::static_mockable<Mock>
+//! {
+//! public:
+//!     double Eval(double x) const
+//!     {
+//!         NVM_MOCK_INTERCEPT(KernelT::Eval, x);
+//!         return std::exp(x);
+//!     }
+//! };
+//! typedef KernelT<> Kernel;
+//!
+//! struct MockKernel : KernelT<MockKernel>
+//! {
+//!     double Eval(double) const { return 1.0; }
+//!
+//!     NVM_STATIC_MOCK_MEMBER_FUNCTION(KernelT<MockKernel>, Eval);
+//! };
+//! \endcode
+//! An object of type KernelT<MockKernel> must be a MockKernel.
+#include "detail/static_dispatch.hpp"
+#include "member_function_traits.hpp"
+
+#include <boost/function_types/result_type.hpp>
+#include <utility>
+
+//! \def NVM_DETAIL_STATIC_MOCK_BINDING( MFNType, MFN, MemberFn )
+//! \brief Declares the binding of MFN to the enclosing mock's MemberFn.
+#define NVM_DETAIL_STATIC_MOCK_BINDING(MFNType, MFN, MemberFn)                               \
+    template <typename... NvmArgs>                                                           \
+    typename boost::function_types::result_type< MFNType >::type                             \
+    nvm_static_call(nvm::detail::static_key< MFNType, MFN >, NvmArgs&&... args)              \
+    {                                                                                        \
+        return this->MemberFn(std::forward<NvmArgs>(args)...);                               \
+    }                                                                                        \
+/***/
+
+//! \def NVM_STATIC_MOCK_MEMBER_FUNCTION( OriginalType, MemberFn )
+//! \brief Binds OriginalType::MemberFn to the mock's own MemberFn at compile time.
+//! Place this in a public section of the mock class, which must declare MemberFn itself.
+//! OriginalType is the intercepting class template instantiated on the mock (use a typedef if its
+//! template argument list contains a comma).
+#define NVM_STATIC_MOCK_MEMBER_FUNCTION(OriginalType, MemberFn)                              \
+    NVM_DETAIL_STATIC_MOCK_BINDING(NVM_TYPEOF(&OriginalType::MemberFn)                       \
+      , &OriginalType::MemberFn                                                              \
+      , MemberFn)                                                                            \
+/***/
+
+//! \def NVM_STATIC_MOCK_OVERLOADED_MEMBER_FUNCTION( OriginalType, MemberFn, Signature )
+//! \brief Binds one overload of a non-const OriginalType::MemberFn to the mock's MemberFn at compile time.
+//! Example usage:
+//! \code
+//! NVM_STATIC_MOCK_OVERLOADED_MEMBER_FUNCTION(KernelT<MockKernel>, Scale, int(int));
+//! \endcode
+#define NVM_STATIC_MOCK_OVERLOADED_MEMBER_FUNCTION(OriginalType, MemberFn, Signature)        \
+    NVM_DETAIL_STATIC_MOCK_BINDING(                                                          \
+        typename nvm::mem_fn_ptr_gen<Signature>::template apply<OriginalType>::type          \
+      , &OriginalType::MemberFn                                                              \
+      , MemberFn)                                                                            \
+/***/
+
+//! \def NVM_STATIC_MOCK_OVERLOADED_CONST_MEMBER_FUNCTION( OriginalType, MemberFn, Signature )
+//! \brief Binds one overload of a const OriginalType::MemberFn to the mock's MemberFn at compile time.
+#define NVM_STATIC_MOCK_OVERLOADED_CONST_MEMBER_FUNCTION(OriginalType, MemberFn, Signature)  \
+    NVM_DETAIL_STATIC_MOCK_BINDING(                                                          \
+        typename nvm::mem_fn_ptr_gen<Signature>::template apply<OriginalType>::const_type    \
+      , &OriginalType::MemberFn                                                              \
+      , MemberFn)                                                                            \
+/***/
+
+#endif // NVM_STATICMOCK_HPP
@@ -0,0 +1,163 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <nvmock/mock.hpp>
+#include <nvmock/async_mock.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct AsyncService : virtual nvm::mockable
+    {
+        std::future<int> Fetch(int key)
+        {
+            NVM_MOCK_INTERCEPT(AsyncService::Fetch, key);
+            return std::async(std::launch::async, [key]() { return key; });
+        }
+
+        void FetchAsync(int key, std::function<void(int)> callback)
+        {
+            NVM_MOCK_INTERCEPT(AsyncService::FetchAsync, key, callback);
+            std::thread([key, callback]() { callback(key); }).detach();
+        }
+    };
+
+    struct MockAsyncService : nvm::mock<AsyncService>
+    {
+        MockAsyncService()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(AsyncService, MockAsyncService, Fetch);
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(AsyncService, MockAsyncService, FetchAsync);
+            }
+        }
+
+        MOCK_METHOD1(Fetch, std::future<int>(int));
+        MOCK_METHOD2(FetchAsync, void(int, std::function<void(int)>));
+    };
+
+    bool IsReady(const std::future<int>& f)
+    {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    TEST(mockTests, TestMockReturnsReadyFutures)
+    {
+        using namespace ::testing;
+        MockAsyncService m;
+        AsyncService& s = m;
+        EXPECT_CALL(m, Fetch(_))
+            .WillOnce(nvm::return_ready_future(7))
+            .WillOnce(Return(ByMove(nvm::make_exceptional_future<int>(std::runtime_error("down")))));
+        std::future<int> f = s.Fetch(1);
+        EXPECT_TRUE(IsReady(f));
+        EXPECT_EQ(7, f.get());
+        EXPECT_THROW(s.Fetch(2).get(), std::runtime_error);
+    }
+
+    TEST(mockTests, TestMockCompletesFuturesInBatches)
+    {
+        using namespace ::testing;
+        nvm::manual_executor ex;
+        MockAsyncService m;
+        AsyncService& s = m;
+        EXPECT_CALL(m, Fetch(_)).WillRepeatedly(nvm::return_future_on(ex, 5));
+
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 10; ++i)
+            futures.push_back(s.Fetch(i));
+        EXPECT_EQ(10u, ex.size());
+        EXPECT_FALSE(IsReady(futures[0]));
+
+        EXPECT_EQ(4u, ex.run(4));
+        for (std::size_t i = 0; i < futures.size(); ++i)
+            EXPECT_EQ(i < 4, IsReady(futures[i]));
+
+        EXPECT_EQ(6u, ex.run_all());
+        EXPECT_TRUE(ex.empty());
+        for (std::size_t i = 0; i < futures.size(); ++i)
+            EXPECT_EQ(5, futures[i].get());
+    }
+
+    TEST(mockTests, TestMockCompletesCallbacksOnExecutor)
+    {
+        using namespace ::testing;
+        nvm::manual_executor ex;
+        MockAsyncService m;
+        AsyncService& s = m;
+        EXPECT_CALL(m, FetchAsync(_, _)).WillRepeatedly(Invoke([&ex](int key, std::function<void(int)> callback)
+        {
+            nvm::complete_on(ex, callback, key * 10);
+        }));
+
+        std::vector<int> results;
+        std::thread::id completedOn;
+        s.FetchAsync(1, [&](int v) { results.push_back(v); completedOn = std::this_thread::get_id(); });
+        s.FetchAsync(2, [&](int v) { results.push_back(v); });
+        EXPECT_TRUE(results.empty());
+        ex.run_all();
+        ASSERT_EQ(2u, results.size());
+        EXPECT_EQ(10, results[0]);
+        EXPECT_EQ(20, results[1]);
+        EXPECT_EQ(std::this_thread::get_id(), completedOn);
+
+        nvm::inline_executor now;
+        EXPECT_EQ(3, nvm::make_future_on(now, 3).get());
+    }
+
+#if defined(__cpp_impl_coroutine)
+    //! A minimal eagerly started coroutine type.
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() { return Detached(); }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    Detached FetchThenStore(AsyncService& s, nvm::manual_executor& ex, int& result)
+    {
+        std::future<int> f = s.Fetch(4);
+        co_await ex.schedule();
+        result = f.get();
+    }
+
+    TEST(mockTests, TestCoroutinesResumeOnExecutor)
+    {
+        using namespace ::testing;
+        nvm::manual_executor ex;
+        MockAsyncService m;
+        EXPECT_CALL(m, Fetch(_)).WillOnce(nvm::return_future_on(ex, 8));
+        int result = 0;
+        FetchThenStore(m, ex, result);
+        EXPECT_EQ(0, result);
+        ex.run_all();
+        EXPECT_EQ(8, result);
+    }
+#endif
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,174 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define NVM_ENABLE_CALL_TRACE
+#include <nvmock/mock.hpp>
+#include <nvmock/call_trace.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct Traced : virtual nvm::mockable
+    {
+        int Add(int a, double b)
+        {
+            NVM_MOCK_INTERCEPT(Traced::Add, a, b);
+            return a + static_cast<int>(b);
+        }
+
+        void Name(const std::string& s, char c) const
+        {
+            NVM_MOCK_INTERCEPT(Traced::Name, s, c);
+        }
+    };
+
+    struct MockTraced : nvm::mock<Traced>
+    {
+        MockTraced()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Traced, MockTraced, Add);
+            }
+        }
+
+        int Add(int, double) { return 0; }
+    };
+
+    std::vector<nvm::call_record> Drain()
+    {
+        std::vector<nvm::call_record> records;
+        EXPECT_EQ(0, nvm::drain_call_trace(records));
+        return records;
+    }
+
+    TEST(mockTests, TestCallTraceRecordsCallsAndTriviallyCopyableArguments)
+    {
+        Traced t;
+        Drain();
+        t.Add(1, 2.0);
+
+        nvm::enable_call_trace();
+        t.Add(3, 4.5);
+        t.Name("ignored", 'x');
+        MockTraced m;
+        static_cast<Traced&>(m).Add(5, 6.0);
+        nvm::enable_call_trace(false);
+        t.Add(7, 8.0);
+
+        std::vector<nvm::call_record> records = Drain();
+        ASSERT_EQ(3, records.size());
+
+        const nvm::call_record& add = records[0];
+        EXPECT_EQ(&t, add.pObject);
+        EXPECT_EQ(2, add.argCount);
+        EXPECT_EQ(3, add.argMask);
+        ASSERT_EQ(sizeof(int) + sizeof(double), add.argBytes);
+        int a; double b;
+        std::memcpy(&a, add.args, sizeof(a));
+        std::memcpy(&b, add.args + sizeof(a), sizeof(b));
+        EXPECT_EQ(3, a);
+        EXPECT_EQ(4.5, b);
+
+        //! The string is not trivially copyable so only the char is copied.
+        const nvm::call_record& name = records[1];
+        EXPECT_NE(add.siteId, name.siteId);
+        EXPECT_EQ(2, name.argCount);
+        EXPECT_EQ(2, name.argMask);
+        ASSERT_EQ(1, name.argBytes);
+        EXPECT_EQ('x', name.args[0]);
+
+        //! Calls through mocks are recorded at the same site.
+        EXPECT_EQ(add.siteId, records[2].siteId);
+        EXPECT_EQ(static_cast<Traced*>(&m), records[2].pObject);
+        EXPECT_LE(add.timestamp, records[2].timestamp);
+    }
+
+    TEST(mockTests, TestCallTraceKeepsThreadsApartAndCountsOverwrites)
+    {
+        Traced t;
+        Drain();
+        nvm::enable_call_trace();
+        std::thread([&]() { t.Add(1, 1.0); }).join();
+        t.Add(2, 2.0);
+        std::thread([&]() { for (int i = 0; i < NVM_CALL_TRACE_CAPACITY + 10; ++i) t.Add(i, 0.0); }).join();
+        nvm::enable_call_trace(false);
+
+        std::vector<nvm::call_record> records;
+        EXPECT_EQ(10, nvm::drain_call_trace(records));
+        ASSERT_EQ(NVM_CALL_TRACE_CAPACITY + 2, records.size());
+        EXPECT_NE(records[0].threadIndex, records[1].threadIndex);
+
+        //! Buffers of threads which have exited are released once drained.
+        EXPECT_TRUE(Drain().empty());
+    }
+
+    TEST(mockTests, TestCallTraceDrainsWhileThreadsRecord)
+    {
+        Traced t;
+        Drain();
+        nvm::enable_call_trace();
+        const int calls = 20 * NVM_CALL_TRACE_CAPACITY;
+        std::atomic<bool> done(false);
+        std::thread writer([&]()
+        {
+            for (int i = 0; i < calls; ++i)
+                t.Add(i, i);
+            done = true;
+        });
+
+        //! Every record read while its slot is being overwritten is discarded, so those kept are whole.
+        std::vector<nvm::call_record> records;
+        std::size_t dropped = 0;
+        while (!done)
+            dropped += nvm::drain_call_trace(records);
+        writer.join();
+        nvm::enable_call_trace(false);
+        dropped += nvm::drain_call_trace(records);
+
+        EXPECT_EQ(static_cast<std::size_t>(calls), records.size() + dropped);
+        for (std::size_t i = 0; i < records.size(); ++i)
+        {
+            int a; double b;
+            std::memcpy(&a, records[i].args, sizeof(a));
+            std::memcpy(&b, records[i].args + sizeof(a), sizeof(b));
+            ASSERT_EQ(static_cast<double>(a), b);
+        }
+    }
+
+    TEST(mockTests, TestCallTraceWritesChromeTraceJson)
+    {
+        Traced t;
+        Drain();
+        nvm::enable_call_trace();
+        t.Add(1, 2.0);
+        nvm::enable_call_trace(false);
+
+        std::ostringstream os;
+        nvm::write_chrome_trace(os, Drain());
+        std::string json = os.str();
+        EXPECT_EQ(0, json.find("{\"traceEvents\":["));
+        EXPECT_NE(std::string::npos, json.find("\"name\":\"Traced::Add\""));
+        EXPECT_NE(std::string::npos, json.find("\"ph\":\"i\""));
+        EXPECT_NE(std::string::npos, json.find("\"bytes\":\"01000000"));
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,181 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define NVM_ENABLE_FAULT_INJECTION
+#include <nvmock/mock.hpp>
+#include <nvmock/fault_injection.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Service : virtual nvm::mockable
+    {
+        Service() : m_writes(0) {}
+
+        int Fetch(int key)
+        {
+            NVM_MOCK_INTERCEPT(Service::Fetch, key);
+            return key * 2;
+        }
+
+        std::string Name() const
+        {
+            NVM_MOCK_INTERCEPT(Service::Name);
+            return "service";
+        }
+
+        void Write(int count)
+        {
+            NVM_MOCK_INTERCEPT(Service::Write, count);
+            m_writes += count;
+        }
+
+        int m_writes;
+    };
+
+    struct MockService : nvm::mock<Service>
+    {
+        MockService()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Service, MockService, Fetch);
+            }
+        }
+
+        MOCK_METHOD1(Fetch, int(int));
+    };
+
+    int Lookup(int key)
+    {
+        NVM_FUNCTION_INTERCEPT(Lookup, key);
+        return key + 1;
+    }
+
+    void Load(const std::string& rules)
+    {
+        std::istringstream is(rules);
+        nvm::load_fault_rules(is);
+    }
+
+    //! The outcome of n calls to Service::Fetch: 0 for an injected fault, 1 otherwise.
+    std::vector<int> Sample(Service& s, int n)
+    {
+        std::vector<int> outcome;
+        for (int i = 0; i < n; ++i)
+        {
+            try
+            {
+                s.Fetch(i);
+                outcome.push_back(1);
+            }
+            catch (const nvm::injected_fault&)
+            {
+                outcome.push_back(0);
+            }
+        }
+        return outcome;
+    }
+
+    TEST(mockTests, TestFaultRulesReturnThrowAndDelay)
+    {
+        Service s;
+        EXPECT_FALSE(nvm::fault_injection_enabled());
+        EXPECT_EQ(6, s.Fetch(3));
+
+        Load("# Rules for the test\n"
+             "Service::Fetch return=-1\n"
+             "Service::Name return=degraded\n"
+             "Service::Write return\n"
+             "Lookup throw=lookup unavailable\n");
+        EXPECT_TRUE(nvm::fault_injection_enabled());
+        EXPECT_EQ(-1, s.Fetch(3));
+        EXPECT_EQ("degraded", s.Name());
+        s.Write(1);
+        EXPECT_EQ(0, s.m_writes);
+        try
+        {
+            Lookup(1);
+            FAIL() << "expected an injected fault";
+        }
+        catch (const nvm::injected_fault& e)
+        {
+            EXPECT_EQ("Lookup", e.site());
+            EXPECT_NE(std::string::npos, std::string(e.what()).find("lookup unavailable"));
+        }
+
+        Load("Service::Fetch delay=20ms");
+        EXPECT_EQ(3, Lookup(2));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        EXPECT_EQ(6, s.Fetch(3));
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+        nvm::clear_fault_rules();
+        EXPECT_FALSE(nvm::fault_injection_enabled());
+        s.Write(1);
+        EXPECT_EQ(1, s.m_writes);
+        EXPECT_EQ("service", s.Name());
+    }
+
+    TEST(mockTests, TestFaultRulesSampleDeterministically)
+    {
+        Service s;
+        Load("seed=7\nService::Fetch throw=flaky rate=0.25");
+        std::vector<int> first = Sample(s, 1000);
+        Load("Service::Fetch throw=flaky rate=0.25\nseed=7");
+        std::vector<int> second = Sample(s, 1000);
+        Load("seed=8\nService::Fetch throw=flaky rate=0.25");
+        std::vector<int> reseeded = Sample(s, 1000);
+        nvm::clear_fault_rules();
+
+        EXPECT_EQ(first, second);
+        EXPECT_NE(first, reseeded);
+        int faults = static_cast<int>(std::count(first.begin(), first.end(), 0));
+        EXPECT_GT(faults, 200);
+        EXPECT_LT(faults, 300);
+    }
+
+    TEST(mockTests, TestFaultRulesApplyBeforeMocks)
+    {
+        using namespace ::testing;
+        MockService m;
+        Service& s = m;
+        EXPECT_CALL(m, Fetch(_)).WillRepeatedly(Return(42));
+        EXPECT_EQ(42, s.Fetch(1));
+        Load("Service::Fetch return=-1");
+        EXPECT_EQ(-1, s.Fetch(1));
+        nvm::clear_fault_rules();
+        EXPECT_EQ(42, s.Fetch(1));
+    }
+
+    TEST(mockTests, TestBadFaultRulesAreRejected)
+    {
+        Service s;
+        Load("Service::Fetch return=-1");
+        EXPECT_THROW(Load("Service::Fetch return=1\nService::Fetch explode"), std::invalid_argument);
+        EXPECT_THROW(Load("Service::Fetch delay=soon"), std::invalid_argument);
+        EXPECT_THROW(Load("Service::Fetch throw rate=2"), std::invalid_argument);
+        EXPECT_EQ(-1, s.Fetch(3));
+        EXPECT_FALSE(nvm::load_fault_rules_file("/nonexistent/nvm_faults"));
+        nvm::clear_fault_rules();
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <nvmock/parallel_test.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstdlib>
+
+//! Two cases register different mocks for the same member function and run concurrently. Each case runs
+//! in its own mock_context so neither sees the other's registration.
+namespace
+{
+    struct Service : virtual nvm::mockable
+    {
+        int Value(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Service::Value, a);
+            return a;
+        }
+    };
+
+    struct MockServiceA : nvm::mock<Service>
+    {
+        MockServiceA()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Service, MockServiceA, Value);
+            }
+        }
+
+        MOCK_CONST_METHOD1(Value, int(int));
+    };
+
+    struct MockServiceB : nvm::mock<Service>
+    {
+        MockServiceB()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Service, MockServiceB, Value);
+            }
+        }
+
+        int Value(int a) const { return -a; }
+    };
+
+    const int Calls = 2000;
+
+    NVM_PARALLEL_TEST(ParallelTests, GmockBasedMock)
+    {
+        using namespace ::testing;
+        MockServiceA m;
+        const Service& s = m;
+        EXPECT_CALL(m, Value(_)).Times(Calls).WillRepeatedly(Return(7));
+        for (int i = 0; i < Calls; ++i)
+            ASSERT_EQ(7, s.Value(i));
+    }
+
+    NVM_PARALLEL_TEST(ParallelTests, HandWrittenMock)
+    {
+        MockServiceB m;
+        const Service& s = m;
+        for (int i = 0; i < Calls; ++i)
+            ASSERT_EQ(-i, s.Value(i));
+    }
+
+    NVM_PARALLEL_TEST(ParallelTests, RealImplementation)
+    {
+        Service s;
+        for (int i = 0; i < Calls; ++i)
+            ASSERT_EQ(i, s.Value(i));
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    nvm::register_parallel_tests(argc > 1 ? std::atoi(argv[1]) : 0);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,51 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <nvmock/mock.hpp>
+#include "shared_registry_plugin.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+//! The mock is registered in this executable while the intercept site lives in the plugin, which is built
+//! with hidden visibility so that it cannot share header statics with the executable by accident.
+namespace
+{
+    struct MockPluginType : nvm::mock<PluginType>
+    {
+        MockPluginType()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(PluginType, MockPluginType, Value);
+            }
+        }
+
+        MOCK_CONST_METHOD1(Value, int(int));
+    };
+
+    TEST(mockTests, TestMockRegisteredInExecutableInterceptsPluginSite)
+    {
+        using namespace ::testing;
+
+        PluginType real;
+        EXPECT_EQ(3, CallValueInPlugin(real, 3));
+
+        MockPluginType m;
+        EXPECT_CALL(m, Value(3)).WillOnce(Return(-3));
+        EXPECT_EQ(-3, CallValueInPlugin(m, 3));
+        EXPECT_EQ(3, CallValueInPlugin(real, 3));
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
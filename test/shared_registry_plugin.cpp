@@ -0,0 +1,21 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define NVM_TEST_PLUGIN_SOURCE
+#include "shared_registry_plugin.hpp"
+
+int PluginType::Value(int a) const
+{
+    NVM_MOCK_INTERCEPT(PluginType::Value, a);
+    return a;
+}
+
+int CallValueInPlugin(const PluginType& p, int a)
+{
+    return p.Value(a);
+}
@@ -0,0 +1,30 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_TEST_SHAREDREGISTRYPLUGIN_HPP
+#define NVM_TEST_SHAREDREGISTRYPLUGIN_HPP
+#pragma once
+
+#include <nvmock/mockable.hpp>
+
+#if defined(NVM_TEST_PLUGIN_SOURCE)
+    #define NVM_TEST_PLUGIN_DECL BOOST_SYMBOL_EXPORT
+#else
+    #define NVM_TEST_PLUGIN_DECL BOOST_SYMBOL_IMPORT
+#endif
+
+//! A type whose intercept site is compiled only into the plugin.
+struct NVM_TEST_PLUGIN_DECL PluginType : virtual nvm::mockable
+{
+    int Value(int a) const;
+};
+
+//! Calls PluginType::Value from inside the plugin.
+NVM_TEST_PLUGIN_DECL int CallValueInPlugin(const PluginType& p, int a);
+
+#endif // NVM_TEST_SHAREDREGISTRYPLUGIN_HPP
@@ -0,0 +1,159 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define NVM_ENABLE_SITE_STATS
+#include <nvmock/mock.hpp>
+#include <nvmock/site_stats.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct Counted : virtual nvm::mockable
+    {
+        int Add(int a, int b) const
+        {
+            NVM_MOCK_INTERCEPT(Counted::Add, a, b);
+            return a + b;
+        }
+
+        int Sub(int a, int b) const
+        {
+            NVM_MOCK_INTERCEPT(Counted::Sub, a, b);
+            return a - b;
+        }
+
+        int Mul(int a, int b) const
+        {
+            NVM_MOCK_INTERCEPT(Counted::Mul, a, b);
+            return a * b;
+        }
+    };
+
+    //! Only Add is registered so calls to Sub on this mock are registry misses.
+    struct MockCounted : nvm::mock<Counted>
+    {
+        MockCounted()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Counted, MockCounted, Add);
+            }
+        }
+
+        int Add(int, int) const { return 0; }
+    };
+
+    nvm::site_stats Find(const std::string& name)
+    {
+        std::vector<nvm::site_stats> stats = nvm::collect_site_stats();
+        for (std::size_t i = 0; i < stats.size(); ++i)
+            if (stats[i].name == name)
+                return stats[i];
+        nvm::site_stats none = { 0, name, 0, 0, 0, 0 };
+        return none;
+    }
+
+    TEST(mockTests, TestSiteStatsCountCallsMocksAndMisses)
+    {
+        nvm::site_stats add0 = Find("Counted::Add");
+        nvm::site_stats sub0 = Find("Counted::Sub");
+
+        Counted c;
+        c.Add(1, 2);
+        c.Sub(1, 2);
+        nvm::site_stats add1 = Find("Counted::Add");
+        EXPECT_EQ(add0.calls + 1, add1.calls);
+        EXPECT_EQ(add0.mocked, add1.mocked);
+        EXPECT_EQ(add0.lookupNanoseconds, add1.lookupNanoseconds);
+
+        {
+            MockCounted m;
+            const Counted& mc = m;
+            EXPECT_EQ(0, mc.Add(1, 2));
+            EXPECT_EQ(-1, mc.Sub(1, 2));
+            EXPECT_EQ(-1, mc.Sub(1, 2));
+            c.Add(1, 2);
+        }
+
+        nvm::site_stats add2 = Find("Counted::Add");
+        nvm::site_stats sub2 = Find("Counted::Sub");
+        EXPECT_EQ(add0.calls + 3, add2.calls);
+        EXPECT_EQ(add0.mocked + 1, add2.mocked);
+        EXPECT_EQ(add0.misses, add2.misses);
+        EXPECT_EQ(sub0.calls + 3, sub2.calls);
+        EXPECT_EQ(sub0.mocked, sub2.mocked);
+        EXPECT_EQ(sub0.misses + 2, sub2.misses);
+        EXPECT_LE(add1.lookupNanoseconds, add2.lookupNanoseconds);
+    }
+
+    TEST(mockTests, TestSiteStatsMergeThreadsIncludingExited)
+    {
+        nvm::site_stats add0 = Find("Counted::Add");
+        Counted c;
+        std::thread t([&]() { for (int i = 0; i < 100; ++i) c.Add(i, i); });
+        t.join();
+        c.Add(0, 0);
+        EXPECT_EQ(add0.calls + 101, Find("Counted::Add").calls);
+
+        //! Counts of the exited thread are kept once folded in.
+        EXPECT_EQ(add0.calls + 101, Find("Counted::Add").calls);
+    }
+
+    TEST(mockTests, TestSiteStatsCountSitesWithLargeIds)
+    {
+        //! Enough sites that Mul's id is past the first segment of block slots (64 blocks of 64 sites).
+        for (int i = 0; i < 5000; ++i)
+            nvm::get_mock_site(&Counted::Add, "filler::" + boost::lexical_cast<std::string>(i));
+
+        //! Counted::Mul is first called here, so its site is created after the fillers.
+        Counted c;
+        for (int i = 0; i < 3; ++i)
+            c.Mul(i, i);
+        nvm::site_stats mul = Find("Counted::Mul");
+        EXPECT_LE(5000u, mul.siteId);
+        EXPECT_EQ(3u, mul.calls);
+    }
+
+    TEST(mockTests, TestSiteStatsWriteTextExposition)
+    {
+        Counted c;
+        c.Add(1, 2);
+        c.Sub(1, 2);
+
+        std::ostringstream os;
+        nvm::write_site_stats(os, nvm::collect_site_stats());
+        std::string text = os.str();
+        EXPECT_NE(std::string::npos, text.find("# TYPE nvm_intercept_calls_total counter\n"));
+        EXPECT_NE(std::string::npos, text.find("nvm_intercept_calls_total{site=\"Counted::Add\"} "));
+        EXPECT_NE(std::string::npos, text.find("nvm_intercept_misses_total{site=\"Counted::Sub\"} "));
+        EXPECT_NE(std::string::npos, text.find("nvm_intercept_lookup_seconds_total{site=\"Counted::Add\"} 0."));
+
+        std::string path = testing::TempDir() + "nvm_site_stats.prom";
+        ASSERT_TRUE(nvm::write_site_stats_file(path));
+        std::ifstream is(path.c_str());
+        std::stringstream contents;
+        contents << is.rdbuf();
+        EXPECT_NE(std::string::npos, contents.str().find("nvm_intercept_calls_total{site=\"Counted::Add\"} "));
+        std::remove(path.c_str());
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
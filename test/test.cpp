@@ -7,9 +7,16 @@
 //  http://www.boost.org/LICENSE_1_0.txt)
 //
 #include <nvmock/mock.hpp>
+#include <nvmock/capture.hpp>
+#include <nvmock/mock_pool.hpp>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
 
 namespace
 {
@@ -353,6 +360,1070 @@ namespace
         EXPECT_EQ(CallSomeMethod2(mst), 24);
     }
 
+    TEST(mockTests, TestMockSiteIsResolvedPerMemberFunction)
+    {
+        using namespace nvm;
+        typedef SomeTypeWithOverloadsInheritsMockable T;
+
+        mock_site& s1 = get_mock_site(&T::SomeMethod2, "SomeTypeWithOverloadsInheritsMockable::SomeMethod2");
+        mock_site& s2 = get_mock_site(&T::SomeMethod2, "SomeTypeWithOverloadsInheritsMockable::SomeMethod2");
+        EXPECT_EQ(&s1, &s2);
+
+        //! Overloads share a name but must not share a site.
+        mock_site& o1 = get_mock_site(mem_fn_ptr_gen<int()>::apply<T>::type(), "SomeTypeWithOverloadsInheritsMockable::SomeMethod");
+        mock_site& o2 = get_mock_site(mem_fn_ptr_gen<void(int, double, float)>::apply<T>::const_type(), "SomeTypeWithOverloadsInheritsMockable::SomeMethod");
+        EXPECT_NE(&o1, &o2);
+        EXPECT_NE(o1.id(), o2.id());
+    }
+
+    TEST(mockTests, TestBoundMockerIsCachedPerInstance)
+    {
+        using namespace ::testing;
+        MockSomeTypeInheritsMockable mst1;
+        MockSomeTypeInheritsMockable mst2;
+        nvm::mock_site& site = nvm::get_mock_site(&SomeTypeInheritsMockable::SomeMethod2, "SomeTypeInheritsMockable::SomeMethod2");
+
+        const nvm::mock_function_base* pFn1 = mst1.get_mock_mem_fn(site);
+        ASSERT_TRUE(pFn1 != 0);
+        EXPECT_EQ(pFn1, mst1.get_mock_mem_fn(site));
+        EXPECT_NE(pFn1, mst2.get_mock_mem_fn(site));
+
+        EXPECT_CALL(mst1, SomeMethod2()).Times(3).WillRepeatedly(Return(7));
+        EXPECT_CALL(mst2, SomeMethod2()).WillOnce(Return(8));
+        EXPECT_EQ(7, CallSomeMethod2(mst1));
+        EXPECT_EQ(7, CallSomeMethod2(mst1));
+        EXPECT_EQ(8, CallSomeMethod2(mst2));
+        EXPECT_EQ(7, CallSomeMethod2(mst1));
+    }
+
+    TEST(mockTests, TestConcurrentRegistrationAndDispatch)
+    {
+        using namespace ::testing;
+        std::atomic<bool> done(false);
+
+        //! Keep growing the registry while other threads are dispatching through it.
+        std::thread writer([&done]()
+        {
+            for (int i = 0; i < 200; ++i)
+                nvm::get_mock_site(&SomeTypeInheritsMockable::SomeMethod2, "concurrent::" + boost::lexical_cast<std::string>(i));
+            done = true;
+        });
+
+        std::vector<std::thread> readers;
+        std::atomic<int> failures(0);
+        for (int t = 0; t < 4; ++t)
+        {
+            readers.emplace_back([&failures]()
+            {
+                MockSomeTypeInheritsMockable mst;
+                ON_CALL(mst, SomeMethod3()).WillByDefault(Return(24));
+                EXPECT_CALL(mst, SomeMethod3()).Times(AnyNumber());
+                for (int i = 0; i < 1000; ++i)
+                    if (CallSomeMethod3(mst) != 24)
+                        ++failures;
+            });
+        }
+
+        writer.join();
+        for (std::size_t i = 0; i < readers.size(); ++i)
+            readers[i].join();
+
+        EXPECT_TRUE(done);
+        EXPECT_EQ(0, failures.load());
+    }
+
+    struct CountsIsMocked : SomeTypeInheritsMockable
+    {
+        CountsIsMocked() : IsMockedCount(0) {}
+
+        virtual bool is_mocked() const
+        {
+            ++IsMockedCount;
+            return false;
+        }
+
+        mutable int IsMockedCount;
+    };
+
+    TEST(mockTests, TestInterceptGateSkipsLookupWithoutLiveMocks)
+    {
+        CountsIsMocked real;
+        ASSERT_FALSE(nvm::any_mock_alive());
+        EXPECT_EQ(-1, CallSomeMethod2(real));
+        EXPECT_EQ(0, real.IsMockedCount);
+
+        {
+            MockSomeTypeInheritsMockable mst;
+            EXPECT_TRUE(nvm::any_mock_alive());
+            EXPECT_EQ(-1, CallSomeMethod2(real));
+            EXPECT_EQ(1, real.IsMockedCount);
+        }
+
+        EXPECT_FALSE(nvm::any_mock_alive());
+        EXPECT_EQ(-1, CallSomeMethod2(real));
+        EXPECT_EQ(1, real.IsMockedCount);
+    }
+
+    struct Overridden : virtual nvm::mockable
+    {
+        int Value(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Overridden::Value, a);
+            return a;
+        }
+    };
+
+    struct MockOverridden : nvm::mock<Overridden>
+    {
+        MockOverridden()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Overridden, MockOverridden, Value);
+            }
+        }
+
+        int Value(int a) const { return -a; }
+    };
+
+    TEST(mockTests, TestScopedOverrideIsThreadLocalAndNests)
+    {
+        Overridden o;
+        MockOverridden m;
+        const Overridden& mo = m;
+        EXPECT_EQ(1, o.Value(1));
+        EXPECT_EQ(-1, mo.Value(1));
+        {
+            NVM_SCOPED_OVERRIDE(outer, Overridden::Value, [](int a) { return a * 10; });
+            EXPECT_EQ(10, o.Value(1));
+            EXPECT_EQ(10, mo.Value(1));
+            {
+                NVM_SCOPED_OVERRIDE(inner, Overridden::Value, [](int a) { return a * 100; });
+                EXPECT_EQ(100, o.Value(1));
+
+                int fromOtherThread = 0, mockFromOtherThread = 0;
+                std::thread([&]() { fromOtherThread = o.Value(1); mockFromOtherThread = mo.Value(1); }).join();
+                EXPECT_EQ(1, fromOtherThread);
+                EXPECT_EQ(-1, mockFromOtherThread);
+            }
+            EXPECT_EQ(10, o.Value(1));
+        }
+        EXPECT_EQ(1, o.Value(1));
+        EXPECT_EQ(-1, mo.Value(1));
+    }
+
+    //! Padded between dir and distance.
+    struct Step
+    {
+        char dir;
+        int  distance;
+
+        bool operator ==(const Step& rhs) const { return dir == rhs.dir && distance == rhs.distance; }
+    };
+
+    //! A Step with the given padding bytes.
+    inline Step make_step(unsigned char padding, char dir, int distance)
+    {
+        Step step;
+        std::memset(&step, padding, sizeof(step));
+        step.dir = dir;
+        step.distance = distance;
+        return step;
+    }
+
+    struct SlowService : virtual nvm::mockable
+    {
+        SlowService() : Calls(0) {}
+
+        double Price(int id, const std::string& name)
+        {
+            NVM_MOCK_INTERCEPT(SlowService::Price, id, name);
+            ++Calls;
+            return id * 1.5 + name.size();
+        }
+
+        void Touch(char c)
+        {
+            NVM_MOCK_INTERCEPT(SlowService::Touch, c);
+            ++Calls;
+        }
+
+        std::string Describe(int id) const
+        {
+            NVM_MOCK_INTERCEPT(SlowService::Describe, id);
+            return "item " + boost::lexical_cast<std::string>(id);
+        }
+
+        int Move(const Step& step)
+        {
+            NVM_MOCK_INTERCEPT(SlowService::Move, step);
+            ++Calls;
+            return step.dir * step.distance;
+        }
+
+        int Calls;
+    };
+
+    struct CapturedSlowService : nvm::capture_mock<SlowService>
+    {
+        template <typename Capture>
+        CapturedSlowService(Capture& c)
+            : nvm::capture_mock<SlowService>(c)
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(SlowService, CapturedSlowService, Price);
+                NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(SlowService, CapturedSlowService, Touch);
+                NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(SlowService, CapturedSlowService, Describe);
+                NVM_REGISTER_CAPTURED_MEMBER_FUNCTION(SlowService, CapturedSlowService, Move);
+            }
+        }
+    };
+
+    TEST(mockTests, TestCaptureRecordsRealCallsAndReplaysThem)
+    {
+        std::string path = ::testing::TempDir() + "nvm_capture_test.bin";
+        {
+            nvm::capture_writer writer(path, 64);
+            CapturedSlowService recording(writer);
+            SlowService& s = recording;
+            EXPECT_EQ(4.5, s.Price(1, "abc"));
+            s.Touch('x');
+            EXPECT_EQ("item 7", s.Describe(7));
+            EXPECT_EQ(3.0, s.Price(2, ""));
+            EXPECT_EQ(3, s.Move(make_step(0, 1, 3)));
+            EXPECT_EQ(4, recording.Calls);
+        }
+
+        nvm::capture_reader reader(path);
+        EXPECT_EQ(5, reader.size());
+        CapturedSlowService replaying(reader);
+        SlowService& s = replaying;
+        EXPECT_EQ(4.5, s.Price(1, "abc"));
+        s.Touch('x');
+
+        //! A mismatched call does not consume the record.
+        EXPECT_THROW(s.Describe(8), std::runtime_error);
+        EXPECT_EQ("item 7", s.Describe(7));
+        EXPECT_EQ(3.0, s.Price(2, ""));
+
+        //! Only the padding differs from the recorded Step.
+        EXPECT_EQ(3, s.Move(make_step(0xff, 1, 3)));
+        EXPECT_EQ(0, replaying.Calls);
+
+        EXPECT_THROW(s.Price(1, "abc"), std::runtime_error);
+        EXPECT_THROW(s.Describe(8), std::runtime_error);
+        std::remove(path.c_str());
+    }
+
+    struct ContextMock : nvm::mock<Overridden>
+    {
+        explicit ContextMock(int result) : Result(result)
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Overridden, ContextMock, Value);
+            }
+        }
+
+        int Value(int) const { return Result; }
+        int Result;
+    };
+
+    TEST(mockTests, TestMockContextsIsolateRegistrations)
+    {
+        nvm::mock_context c1, c2;
+        int fromC1 = 0, fromC2 = 0, fromOtherMock = 0;
+        std::thread t1([&]()
+        {
+            nvm::scoped_mock_context bind(c1);
+            ContextMock m(1);
+            fromC1 = static_cast<const Overridden&>(m).Value(0);
+        });
+        t1.join();
+        std::thread t2([&]()
+        {
+            //! The once block runs again in this context and MockOverridden is registered only here.
+            nvm::scoped_mock_context bind(c2);
+            MockOverridden m;
+            fromC2 = static_cast<const Overridden&>(m).Value(2);
+            ContextMock other(3);
+            fromOtherMock = static_cast<const Overridden&>(other).Value(0);
+        });
+        t2.join();
+
+        EXPECT_EQ(1, fromC1);
+        EXPECT_EQ(-2, fromC2);
+        EXPECT_EQ(3, fromOtherMock);
+
+        //! The process wide registration is untouched.
+        MockOverridden m;
+        EXPECT_EQ(-5, static_cast<const Overridden&>(m).Value(5));
+    }
+
+    struct Snapshotted : virtual nvm::mockable
+    {
+        int Value(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Snapshotted::Value, a);
+            return a;
+        }
+
+        int Other(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Snapshotted::Other, a);
+            return a;
+        }
+    };
+
+    int g_baselineRegistrations = 0;
+
+    //! The expensive baseline: registered once and shared by every test context.
+    struct BaselineMock : nvm::mock<Snapshotted>
+    {
+        BaselineMock()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                ++g_baselineRegistrations;
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Snapshotted, BaselineMock, Value);
+            }
+        }
+
+        int Value(int a) const { return -a; }
+    };
+
+    int g_perTestRegistrations = 0;
+
+    //! A per test addition on top of the baseline.
+    struct PerTestMock : nvm::mock<Snapshotted>
+    {
+        PerTestMock()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                ++g_perTestRegistrations;
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Snapshotted, PerTestMock, Other);
+            }
+        }
+
+        int Other(int a) const { return 100 + a; }
+    };
+
+    TEST(mockTests, TestMockContextSnapshotsRestoreRegistrations)
+    {
+        nvm::mock_context::snapshot baseline;
+        {
+            nvm::mock_context c;
+            nvm::scoped_mock_context bind(c);
+            { BaselineMock m; }
+            baseline = c.get_snapshot();
+        }
+        EXPECT_EQ(1, g_baselineRegistrations);
+
+        //! Each test context starts from the baseline without running its once blocks again, even though the
+        //! context which registered it is gone, and its own registrations do not leak into the next test.
+        for (int test = 0; test < 3; ++test)
+        {
+            nvm::mock_context c(baseline);
+            nvm::scoped_mock_context bind(c);
+            {
+                BaselineMock m;
+                EXPECT_EQ(-2, static_cast<const Snapshotted&>(m).Value(2));
+                EXPECT_EQ(2, static_cast<const Snapshotted&>(m).Other(2));
+            }
+            g_perTestRegistrations = 0;
+            {
+                PerTestMock m;
+                EXPECT_EQ(2, static_cast<const Snapshotted&>(m).Value(2));
+                EXPECT_EQ(102, static_cast<const Snapshotted&>(m).Other(2));
+            }
+            EXPECT_EQ(1, g_perTestRegistrations);
+
+            //! Restoring within a context drops the per test registration and its once block entry.
+            PerTestMock live;
+            const Snapshotted& s = live;
+            nvm::mock_context::snapshot withPerTest = c.get_snapshot();
+            c.restore(baseline);
+            EXPECT_EQ(2, s.Other(2));
+            { PerTestMock m; }
+            EXPECT_EQ(2, g_perTestRegistrations);
+            EXPECT_EQ(102, s.Other(2));
+            c.restore(baseline);
+            EXPECT_EQ(2, s.Other(2));
+            c.restore(withPerTest);
+            EXPECT_EQ(102, s.Other(2));
+            {
+                PerTestMock m;
+                EXPECT_EQ(102, static_cast<const Snapshotted&>(m).Other(2));
+            }
+            EXPECT_EQ(2, g_perTestRegistrations);
+        }
+        EXPECT_EQ(1, g_baselineRegistrations);
+    }
+
+    struct NullMocker : nvm::mocker
+    {
+        boost::shared_ptr<nvm::mock_function_base> operator()(void*) const { return boost::shared_ptr<nvm::mock_function_base>(); }
+    };
+
+    TEST(mockTests, TestMockContextSnapshotsOfManySites)
+    {
+        //! Enough sites that the context's tree has three levels.
+        std::vector<nvm::mock_site*> sites;
+        for (int i = 0; i < 5000; ++i)
+            sites.push_back(&nvm::detail::site_registry::instance().get_site("context_filler::" + boost::lexical_cast<std::string>(i), "context_filler"));
+        boost::shared_ptr<nvm::mocker> pFirst = boost::make_shared<NullMocker>();
+        boost::shared_ptr<nvm::mocker> pSecond = boost::make_shared<NullMocker>();
+
+        nvm::mock_context c;
+        for (std::size_t i = 0; i < sites.size(); i += 2)
+            c.set_mocker(*sites[i], pFirst);
+        nvm::mock_context::snapshot first = c.get_snapshot();
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            c.set_mocker(*sites[i], pSecond);
+
+        int mismatches = 0;
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            mismatches += c.get_mocker(*sites[i]) != pSecond.get();
+        EXPECT_EQ(0, mismatches);
+
+        //! Registrations made after the snapshot did not write the nodes it shares.
+        c.restore(first);
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            mismatches += c.get_mocker(*sites[i]) != (i % 2 ? 0 : pFirst.get());
+        EXPECT_EQ(0, mismatches);
+    }
+
+    //! Binds a new callable each time, so the callables of a mock_fn_cache can be told apart.
+    struct FreshMocker : nvm::mocker
+    {
+        boost::shared_ptr<nvm::mock_function_base> operator()(void*) const { return boost::make_shared<nvm::mock_function_base>(); }
+    };
+
+    TEST(mockTests, TestMockFnCacheKeepsEntriesAcrossGrowth)
+    {
+        std::vector<nvm::mock_site*> sites;
+        for (int i = 0; i < 100; ++i)
+            sites.push_back(&nvm::detail::site_registry::instance().get_site("cache_site::" + boost::lexical_cast<std::string>(i), "cache_site"));
+        boost::shared_ptr<nvm::mocker> pFirst = boost::make_shared<FreshMocker>();
+        boost::shared_ptr<nvm::mocker> pSecond = boost::make_shared<FreshMocker>();
+        nvm::mock_context c;
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            c.set_mocker(*sites[i], pFirst);
+
+        nvm::detail::mock_fn_cache cache;
+        std::vector<const nvm::mock_function_base*> fns;
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            fns.push_back(cache.get(*sites[i], 0, &c));
+
+        //! The table has doubled several times; every site still finds the callable bound on its first call.
+        int mismatches = 0;
+        for (std::size_t i = 0; i < sites.size(); ++i)
+            mismatches += !fns[i] || cache.get(*sites[i], 0, &c) != fns[i];
+        EXPECT_EQ(0, mismatches);
+
+        //! A new registration replaces the site's entry and leaves the others alone.
+        c.set_mocker(*sites[7], pSecond);
+        const nvm::mock_function_base* pRebound = cache.get(*sites[7], 0, &c);
+        EXPECT_NE(fns[7], pRebound);
+        EXPECT_EQ(pRebound, cache.get(*sites[7], 0, &c));
+        EXPECT_EQ(fns[8], cache.get(*sites[8], 0, &c));
+    }
+
+    struct Variant : virtual nvm::mockable
+    {
+        int Value(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Variant::Value, a);
+            return a;
+        }
+    };
+
+    struct NegatingVariant : nvm::mock<Variant>
+    {
+        NegatingVariant()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Variant, NegatingVariant, Value);
+            }
+        }
+
+        int Value(int a) const { return -a; }
+    };
+
+    struct DoublingVariant : nvm::mock<Variant>
+    {
+        DoublingVariant() : Factor(2)
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Variant, DoublingVariant, Value);
+            }
+        }
+
+        int Value(int a) const { return Factor * a; }
+        int Factor;
+    };
+
+    //! Registers nothing of its own, so it dispatches through the registrations of NegatingVariant.
+    struct DerivedNegatingVariant : NegatingVariant
+    {
+    };
+
+    //! Registers through a mock table.
+    struct TabledVariant : nvm::mock<Variant>
+    {
+        int Value(int a) const { return 1000 + a; }
+    };
+
+    NVM_BEGIN_MOCK_TABLE(TabledVariant)
+        NVM_MOCK_TABLE_MEMBER_FUNCTION(Variant, Value)
+    NVM_END_MOCK_TABLE()
+
+    TEST(mockTests, TestMockVariantsOfOneClassCoexist)
+    {
+        NegatingVariant negating;
+        DoublingVariant doubling;
+        TabledVariant tabled;
+        const Variant& n = negating;
+        const Variant& d = doubling;
+        const Variant& t = tabled;
+        EXPECT_EQ(-3, n.Value(3));
+        EXPECT_EQ(6, d.Value(3));
+        EXPECT_EQ(1003, t.Value(3));
+
+        //! Registering a variant again (here in a context) does not redirect the others.
+        nvm::mock_context c;
+        {
+            nvm::scoped_mock_context bind(c);
+            DoublingVariant inContext;
+            NegatingVariant negatingInContext;
+            EXPECT_EQ(8, static_cast<const Variant&>(inContext).Value(4));
+            EXPECT_EQ(-4, static_cast<const Variant&>(negatingInContext).Value(4));
+        }
+        EXPECT_EQ(-3, n.Value(3));
+        EXPECT_EQ(6, d.Value(3));
+
+        DerivedNegatingVariant derived;
+        EXPECT_EQ(-3, static_cast<const Variant&>(derived).Value(3));
+    }
+
+    struct Tabled : virtual nvm::mockable
+    {
+        int Value(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Tabled::Value, a);
+            return a;
+        }
+
+        int Scale(int a)
+        {
+            NVM_MOCK_OVERLOAD_INTERCEPT(Tabled, Scale, int(int), a);
+            return a;
+        }
+
+        int Scale(int a) const
+        {
+            NVM_MOCK_OVERLOAD_CONST_INTERCEPT(Tabled, Scale, int(int), a);
+            return a;
+        }
+    };
+
+    //! Registered by the mock table below, so the constructor has nothing to do.
+    struct MockTabled : nvm::mock<Tabled>
+    {
+        int Value(int a) const { return -a; }
+        int Scale(int a) { return 2 * a; }
+        int Scale(int a) const { return 3 * a; }
+    };
+
+    NVM_BEGIN_MOCK_TABLE(MockTabled)
+        NVM_MOCK_TABLE_MEMBER_FUNCTION(Tabled, Value)
+        NVM_MOCK_TABLE_OVERLOADED_MEMBER_FUNCTION(Tabled, Scale, int(int))
+        NVM_MOCK_TABLE_OVERLOADED_CONST_MEMBER_FUNCTION(Tabled, Scale, int(int))
+    NVM_END_MOCK_TABLE()
+
+    struct ShadowTabled : nvm::mock<Tabled>
+    {
+        ShadowTabled()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Tabled, ShadowTabled, Value);
+            }
+        }
+
+        int Value(int a) const { return 100 + a; }
+    };
+
+    TEST(mockTests, TestMockTableIsLoadedAtStaticInit)
+    {
+        MockTabled m;
+        Tabled& t = m;
+        const Tabled& ct = m;
+        EXPECT_EQ(-1, ct.Value(1));
+        EXPECT_EQ(4, t.Scale(2));
+        EXPECT_EQ(6, ct.Scale(2));
+
+        //! Table entries apply in every context and run time registrations in a context shadow them.
+        nvm::mock_context c1, c2;
+        int fromC1 = 0, fromC2 = 0;
+        std::thread t1([&]()
+        {
+            nvm::scoped_mock_context bind(c1);
+            MockTabled m;
+            fromC1 = static_cast<const Tabled&>(m).Value(2);
+        });
+        t1.join();
+        std::thread t2([&]()
+        {
+            nvm::scoped_mock_context bind(c2);
+            ShadowTabled s;
+            fromC2 = static_cast<const Tabled&>(s).Value(2);
+        });
+        t2.join();
+        EXPECT_EQ(-2, fromC1);
+        EXPECT_EQ(102, fromC2);
+        EXPECT_EQ(-3, ct.Value(3));
+    }
+
+    int Tick()
+    {
+        NVM_FUNCTION_INTERCEPT(Tick);
+        return 1;
+    }
+
+    double Scaled(double x)
+    {
+        NVM_FUNCTION_OVERLOAD_INTERCEPT(Scaled, double(double), x);
+        return 2 * x;
+    }
+
+    int Scaled(int x)
+    {
+        NVM_FUNCTION_OVERLOAD_INTERCEPT(Scaled, int(int), x);
+        return 2 * x;
+    }
+
+    struct Rng
+    {
+        static int Next(int bound)
+        {
+            NVM_FUNCTION_INTERCEPT(Rng::Next, bound);
+            return bound - 1;
+        }
+    };
+
+    TEST(mockTests, TestFunctionMocksRedirectFreeAndStaticFunctions)
+    {
+        EXPECT_EQ(1, Tick());
+        EXPECT_EQ(5, Rng::Next(6));
+        {
+            NVM_FUNCTION_MOCK(tick, Tick, []() { return 7; });
+            NVM_FUNCTION_MOCK(next, Rng::Next, [](int) { return 0; });
+            NVM_FUNCTION_OVERLOAD_MOCK(scaled, Scaled, int(int), [](int x) { return 3 * x; });
+            EXPECT_EQ(7, Tick());
+            EXPECT_EQ(0, Rng::Next(6));
+            EXPECT_EQ(6, Scaled(2));
+            EXPECT_EQ(4.0, Scaled(2.0));
+            {
+                NVM_FUNCTION_MOCK(inner, Tick, []() { return 8; });
+                EXPECT_EQ(8, Tick());
+            }
+            EXPECT_EQ(7, Tick());
+
+            //! Function mocks apply on every thread.
+            int fromThread = 0;
+            std::thread t([&]() { fromThread = Tick(); });
+            t.join();
+            EXPECT_EQ(7, fromThread);
+        }
+        EXPECT_EQ(1, Tick());
+        EXPECT_EQ(5, Rng::Next(6));
+        EXPECT_EQ(4, Scaled(2));
+    }
+
+    TEST(mockTests, TestScopedOverridesAndPassThroughApplyToFunctions)
+    {
+        NVM_FUNCTION_MOCK(tick, Tick, []() { return 7; });
+        {
+            NVM_SCOPED_OVERRIDE(o, Tick, []() { return 11; });
+            NVM_SCOPED_FUNCTION_OVERLOAD_OVERRIDE(scaled, Scaled, int(int), [](int x) { return -x; });
+            EXPECT_EQ(11, Tick());
+            EXPECT_EQ(-2, Scaled(2));
+            EXPECT_EQ(4.0, Scaled(2.0));
+
+            //! Other threads still see the function mock.
+            int fromThread = 0;
+            std::thread t([&]() { fromThread = Tick(); });
+            t.join();
+            EXPECT_EQ(7, fromThread);
+        }
+        {
+            nvm::detail::scoped_pass_through real(nvm::get_mock_site(&Tick, "Tick").id());
+            EXPECT_EQ(1, Tick());
+        }
+        EXPECT_EQ(7, Tick());
+    }
+
+    TEST(mockTests, TestFunctionMocksReuseTheirMockers)
+    {
+        nvm::mock_site& site = nvm::get_mock_site(&Tick, "Tick");
+        nvm::mocker* pFirst = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            NVM_FUNCTION_MOCK(tick, Tick, [i]() { return i; });
+            EXPECT_EQ(i, Tick());
+            if (!pFirst)
+                pFirst = site.get_mocker();
+            EXPECT_EQ(pFirst, site.get_mocker());
+        }
+        EXPECT_EQ(1, Tick());
+    }
+
+    TEST(mockTests, TestFunctionMocksAreIsolatedByContext)
+    {
+        nvm::mock_context c1;
+        int inContext = 0, afterContext = 0, outsideContext = 0;
+        std::thread t1([&]()
+        {
+            nvm::scoped_mock_context bind(c1);
+            {
+                NVM_FUNCTION_MOCK(tick, Tick, []() { return 9; });
+                inContext = Tick();
+                std::thread t2([&]() { outsideContext = Tick(); });
+                t2.join();
+            }
+            afterContext = Tick();
+        });
+        t1.join();
+        EXPECT_EQ(9, inContext);
+        EXPECT_EQ(1, outsideContext);
+        EXPECT_EQ(1, afterContext);
+        EXPECT_EQ(1, Tick());
+    }
+
+    struct Node : virtual nvm::mockable
+    {
+        Node(int id, int& destroyed) : Id(id), pDestroyed(&destroyed) {}
+        ~Node() { ++*pDestroyed; }
+
+        int Value() const
+        {
+            NVM_MOCK_INTERCEPT(Node::Value);
+            return Id;
+        }
+
+        int  Id;
+        int* pDestroyed;
+    };
+
+    struct MockNode : nvm::mock<Node>
+    {
+        MockNode(int id, int& destroyed) : nvm::mock<Node>(id, destroyed) {}
+
+        int Value() const { return -Id; }
+    };
+
+    NVM_BEGIN_MOCK_TABLE(MockNode)
+        NVM_MOCK_TABLE_MEMBER_FUNCTION(Node, Value)
+    NVM_END_MOCK_TABLE()
+
+    TEST(mockTests, TestMockPoolRecyclesStorage)
+    {
+        int destroyed = 0;
+        nvm::mock_pool<MockNode> pool(4);
+        std::vector<MockNode*> nodes;
+        pool.create_n(10, nodes, 7, destroyed);
+        ASSERT_EQ(10, nodes.size());
+        EXPECT_EQ(10, pool.size());
+        EXPECT_EQ(12, pool.capacity());
+        EXPECT_EQ(-7, static_cast<const Node&>(*nodes[9]).Value());
+
+        MockNode* pFirst = nodes[0];
+        pool.destroy(pFirst);
+        EXPECT_EQ(1, destroyed);
+        EXPECT_EQ(pFirst, pool.create(3, destroyed));
+
+        //! Clearing destroys every mock but keeps the storage for the next iteration.
+        pool.clear();
+        EXPECT_EQ(11, destroyed);
+        EXPECT_EQ(0, pool.size());
+        nodes.clear();
+        pool.create_n(12, nodes, 1, destroyed);
+        EXPECT_EQ(12, pool.capacity());
+        EXPECT_EQ(-1, static_cast<const Node&>(*nodes[11]).Value());
+    }
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+    struct Owner : virtual nvm::mockable
+    {
+        explicit Owner(std::unique_ptr<int> p) : P(std::move(p)) {}
+
+        int Value() const
+        {
+            NVM_MOCK_INTERCEPT(Owner::Value);
+            return *P;
+        }
+
+        std::unique_ptr<int> P;
+    };
+
+    TEST(mockTests, TestMockConstructorsForwardArguments)
+    {
+        //! Move only arguments reach the mocked type's constructor.
+        nvm::mock<Owner> m(std::unique_ptr<int>(new int(4)));
+        EXPECT_EQ(4, *m.P);
+
+        nvm::mock_pool< nvm::mock<Owner> > pool;
+        nvm::mock<Owner>* pOwner = pool.create(std::unique_ptr<int>(new int(5)));
+        EXPECT_EQ(5, *pOwner->P);
+
+        std::string path = ::testing::TempDir() + "nvm_forward_test.bin";
+        {
+            nvm::capture_writer writer(path, 8);
+            nvm::capture_mock<Owner> captured(writer, std::unique_ptr<int>(new int(6)));
+            EXPECT_EQ(6, *captured.P);
+        }
+        std::remove(path.c_str());
+    }
+#endif
+
+#if defined(NVM_HAS_VARIADIC_TEMPLATES)
+    //! The variadic implementation has no arity limit.
+    struct ManyParameters : virtual nvm::mockable
+    {
+        int Sum(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l) const
+        {
+            NVM_MOCK_INTERCEPT(ManyParameters::Sum, a, b, c, d, e, f, g, h, i, j, k, l);
+            return 0;
+        }
+    };
+
+    struct MockManyParameters : nvm::mock<ManyParameters>
+    {
+        MockManyParameters()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(ManyParameters, MockManyParameters, Sum);
+            }
+        }
+
+        int Sum(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l) const
+        {
+            return a + b + c + d + e + f + g + h + i + j + k + l;
+        }
+    };
+
+    //! Counts copies so that forwarding through an intercept can be checked.
+    struct CopyCounter
+    {
+        CopyCounter() {}
+        CopyCounter(const CopyCounter&) { ++Copies; }
+        CopyCounter(CopyCounter&&) {}
+        CopyCounter& operator =(const CopyCounter&) { ++Copies; return *this; }
+        static int Copies;
+    };
+    int CopyCounter::Copies = 0;
+
+    struct Forwarding : virtual nvm::mockable
+    {
+        Forwarding() : Value(0) {}
+
+        std::unique_ptr<int> Take(std::unique_ptr<int> p)
+        {
+            NVM_MOCK_INTERCEPT(Forwarding::Take, p);
+            return p;
+        }
+
+        CopyCounter Pass(CopyCounter c, const CopyCounter& r)
+        {
+            NVM_MOCK_INTERCEPT(Forwarding::Pass, c, r);
+            return c;
+        }
+
+        int& Ref()
+        {
+            NVM_MOCK_INTERCEPT(Forwarding::Ref);
+            return Value;
+        }
+
+        int Value;
+    };
+
+    struct MockForwarding : nvm::mock<Forwarding>
+    {
+        MockForwarding() : MockValue(0)
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Forwarding, MockForwarding, Take);
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Forwarding, MockForwarding, Pass);
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Forwarding, MockForwarding, Ref);
+            }
+        }
+
+        std::unique_ptr<int> Take(std::unique_ptr<int> p)
+        {
+            *p += 1;
+            return p;
+        }
+
+        CopyCounter Pass(CopyCounter c, const CopyCounter&)
+        {
+            return c;
+        }
+
+        int& Ref()
+        {
+            return MockValue;
+        }
+
+        int MockValue;
+    };
+
+    TEST(mockTests, TestInterceptForwardsArgumentsAndResults)
+    {
+        MockForwarding m;
+        Forwarding& f = m;
+
+        std::unique_ptr<int> p = f.Take(std::unique_ptr<int>(new int(41)));
+        ASSERT_TRUE(p != nullptr);
+        EXPECT_EQ(42, *p);
+
+        CopyCounter c;
+        CopyCounter::Copies = 0;
+        f.Pass(std::move(c), c);
+        EXPECT_EQ(0, CopyCounter::Copies);
+
+        f.Ref() = 7;
+        EXPECT_EQ(7, m.MockValue);
+        EXPECT_EQ(0, m.Value);
+    }
+
+    TEST(mockTests, TestMockingMoreParametersThanPreprocessedLimit)
+    {
+        MockManyParameters m;
+        const ManyParameters& p = m;
+        EXPECT_EQ(78, p.Sum(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12));
+    }
+
+    template <typename Mock = void>
+    class KernelT : public nvm::static_mockable<Mock>
+    {
+    public:
+
+        double Eval(double x) const
+        {
+            NVM_MOCK_INTERCEPT(KernelT::Eval, x);
+            return x * x;
+        }
+
+        int Scale(int a)
+        {
+            NVM_MOCK_OVERLOAD_INTERCEPT(KernelT, Scale, int(int), a);
+            return 2 * a;
+        }
+
+        int Scale(int a, int b)
+        {
+            NVM_MOCK_OVERLOAD_INTERCEPT(KernelT, Scale, int(int, int), a, b);
+            return a * b;
+        }
+
+        std::unique_ptr<int> Take(std::unique_ptr<int> p) const
+        {
+            NVM_MOCK_INTERCEPT(KernelT::Take, std::move(p));
+            return p;
+        }
+    };
+
+    struct StaticMockKernel : KernelT<StaticMockKernel>
+    {
+        double Eval(double) const { return 1.0; }
+        int Scale(int a) { return -a; }
+        std::unique_ptr<int> Take(std::unique_ptr<int> p) const { ++*p; return p; }
+
+        NVM_STATIC_MOCK_MEMBER_FUNCTION(KernelT<StaticMockKernel>, Eval);
+        NVM_STATIC_MOCK_OVERLOADED_MEMBER_FUNCTION(KernelT<StaticMockKernel>, Scale, int(int));
+        NVM_STATIC_MOCK_MEMBER_FUNCTION(KernelT<StaticMockKernel>, Take);
+    };
+
+    struct StaticGmockKernel : KernelT<StaticGmockKernel>
+    {
+        MOCK_CONST_METHOD1(Eval, double(double));
+
+        NVM_STATIC_MOCK_MEMBER_FUNCTION(KernelT<StaticGmockKernel>, Eval);
+    };
+
+    //! Code which is templated on its dependency.
+    template <typename Kernel>
+    double SumOfSquares(const Kernel& k, int n)
+    {
+        double sum = 0;
+        for (int i = 0; i < n; ++i)
+            sum += k.Eval(i);
+        return sum;
+    }
+
+    TEST(mockTests, TestStaticMockBindsInterceptsAtCompileTime)
+    {
+        KernelT<> real;
+        EXPECT_EQ(14.0, SumOfSquares(real, 4));
+        EXPECT_EQ(6, real.Scale(3));
+
+        StaticMockKernel m;
+        KernelT<StaticMockKernel>& k = m;
+        EXPECT_FALSE(nvm::any_mock_alive());
+        EXPECT_EQ(4.0, SumOfSquares(k, 4));
+        EXPECT_EQ(-3, k.Scale(3));
+
+        //! The other overload is not bound and runs the real implementation.
+        EXPECT_EQ(12, k.Scale(3, 4));
+
+        std::unique_ptr<int> p = k.Take(std::unique_ptr<int>(new int(41)));
+        EXPECT_EQ(42, *p);
+
+        using namespace ::testing;
+        StaticGmockKernel g;
+        EXPECT_CALL(g, Eval(_)).Times(3).WillRepeatedly(Return(2.0));
+        EXPECT_EQ(6.0, SumOfSquares(static_cast<const KernelT<StaticGmockKernel>&>(g), 3));
+    }
+
+    struct DestructionCounter
+    {
+        explicit DestructionCounter(int& count) : pCount(&count) {}
+        DestructionCounter(DestructionCounter&& o) : pCount(o.pCount) { o.pCount = 0; }
+        ~DestructionCounter() { if (pCount) ++*pCount; }
+        int* pCount;
+    };
+
+    TEST(mockTests, TestMockFunctionStoresSmallAndLargeCallables)
+    {
+        int destroyed = 0;
+        {
+            //! Stateful callables are invoked as non-const, as std::function does.
+            DestructionCounter counter(destroyed);
+            int calls = 0;
+            nvm::mock_function<int(int)> small([counter = std::move(counter), calls](int a) mutable { return a + ++calls; });
+            EXPECT_EQ(2, small(1));
+            EXPECT_EQ(3, small(1));
+        }
+        EXPECT_EQ(1, destroyed);
+
+        {
+            char big[4 * NVM_MOCK_FUNCTION_BUFFER_SIZE] = { 5 };
+            DestructionCounter counter(destroyed);
+            nvm::mock_function<int(std::unique_ptr<int>)> large([big, counter = std::move(counter)](std::unique_ptr<int> p) { return *p + big[0]; });
+            EXPECT_EQ(6, large(std::unique_ptr<int>(new int(1))));
+        }
+        EXPECT_EQ(2, destroyed);
+    }
+#endif
+
 }//! anonymous
 
 int main(int argc, char** argv)
@@ -0,0 +1,137 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define NVM_ENABLE_USDT
+#include <nvmock/mock.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+    #include <elf.h>
+#endif
+
+namespace
+{
+    struct Probed : virtual nvm::mockable
+    {
+        int Value(int a) const
+        {
+            NVM_MOCK_INTERCEPT(Probed::Value, a);
+            return a;
+        }
+    };
+
+    struct MockProbed : nvm::mock<Probed>
+    {
+        MockProbed()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Probed, MockProbed, Value);
+            }
+        }
+
+        MOCK_CONST_METHOD1(Value, int(int));
+    };
+
+    int Twice(int a)
+    {
+        NVM_FUNCTION_INTERCEPT(Twice, a);
+        return 2 * a;
+    }
+
+    TEST(mockTests, TestProbedInterceptsBehaveAsBefore)
+    {
+        using namespace ::testing;
+        Probed p;
+        EXPECT_EQ(3, p.Value(3));
+        EXPECT_EQ(6, Twice(3));
+
+        MockProbed m;
+        const Probed& mocked = m;
+        EXPECT_CALL(m, Value(3)).WillOnce(Return(-3));
+        EXPECT_EQ(-3, mocked.Value(3));
+        {
+            NVM_FUNCTION_MOCK(twice, Twice, [](int a) { return a; });
+            EXPECT_EQ(3, Twice(3));
+        }
+        EXPECT_EQ(6, Twice(3));
+    }
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+    //! Tracers find probes through the NT_STAPSDT (3) notes of the .note.stapsdt section: owner "stapsdt", then
+    //! the probe, base and semaphore addresses, then the provider, probe name and argument description.
+    bool HasProbeNote(const std::string& image, const std::string& provider, const std::string& probe)
+    {
+        if (image.size() < sizeof(Elf64_Ehdr))
+            return false;
+        Elf64_Ehdr header;
+        std::memcpy(&header, image.data(), sizeof(header));
+        if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 || header.e_ident[EI_CLASS] != ELFCLASS64)
+            return false;
+        if (header.e_shoff + header.e_shnum * sizeof(Elf64_Shdr) > image.size() || header.e_shstrndx >= header.e_shnum)
+            return false;
+
+        std::vector<Elf64_Shdr> sections(header.e_shnum);
+        std::memcpy(&sections[0], image.data() + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+        const Elf64_Shdr& names = sections[header.e_shstrndx];
+        for (std::size_t i = 0; i < sections.size(); ++i)
+        {
+            if (sections[i].sh_type != SHT_NOTE || names.sh_offset + sections[i].sh_name >= image.size())
+                continue;
+            if (std::strcmp(image.c_str() + names.sh_offset + sections[i].sh_name, ".note.stapsdt") != 0)
+                continue;
+
+            std::size_t pos = sections[i].sh_offset;
+            std::size_t end = std::min<std::size_t>(pos + sections[i].sh_size, image.size());
+            while (pos + sizeof(Elf64_Nhdr) <= end)
+            {
+                Elf64_Nhdr note;
+                std::memcpy(&note, image.data() + pos, sizeof(note));
+                std::size_t name = pos + sizeof(note);
+                std::size_t desc = name + ((note.n_namesz + 3) & ~3u);
+                pos = desc + ((note.n_descsz + 3) & ~3u);
+                if (pos > end)
+                    break;
+                if (note.n_type != 3 || note.n_descsz <= 24 || std::string(image.data() + name, note.n_namesz) != std::string("stapsdt", 8))
+                    continue;
+
+                //! Three 8 byte addresses, then the NUL terminated strings.
+                std::string strings(image.data() + desc + 24, note.n_descsz - 24);
+                std::string::size_type probeAt = strings.find('\0');
+                if (strings.substr(0, probeAt) == provider && probeAt != std::string::npos &&
+                    strings.compare(probeAt + 1, probe.size() + 1, std::string(probe.c_str(), probe.size() + 1)) == 0)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    TEST(mockTests, TestInterceptsEmitProbeNotes)
+    {
+        std::ifstream is("/proc/self/exe", std::ios::binary);
+        ASSERT_TRUE(is.good());
+        std::string image((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+        EXPECT_TRUE(HasProbeNote(image, "nvmock", "call"));
+        EXPECT_FALSE(HasProbeNote(image, "nvmock", "absent"));
+    }
+#endif
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
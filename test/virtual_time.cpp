@@ -0,0 +1,203 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define NVM_ENABLE_FAULT_INJECTION
+#include <nvmock/mock.hpp>
+#include <nvmock/fault_injection.hpp>
+#include <nvmock/virtual_time.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using std::chrono::milliseconds;
+    using std::chrono::minutes;
+    using std::chrono::seconds;
+
+    std::int64_t NowSeconds()
+    {
+        NVM_FUNCTION_INTERCEPT(NowSeconds);
+        return std::chrono::duration_cast<seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Backend : virtual nvm::mockable
+    {
+        int Fetch(int key)
+        {
+            NVM_MOCK_INTERCEPT(Backend::Fetch, key);
+            return key;
+        }
+    };
+
+    struct MockBackend : nvm::mock<Backend>
+    {
+        MockBackend()
+        {
+            NVM_ONCE_BLOCK()
+            {
+                NVM_REGISTER_MOCK_MEMBER_FUNCTION(Backend, MockBackend, Fetch);
+            }
+        }
+
+        MOCK_METHOD1(Fetch, int(int));
+    };
+
+    //! Retries until the backend answers or the deadline passes; the code under test.
+    int FetchWithRetry(Backend& backend, int key, std::int64_t timeoutSeconds)
+    {
+        std::int64_t deadline = NowSeconds() + timeoutSeconds;
+        while (NowSeconds() < deadline)
+        {
+            int value = backend.Fetch(key);
+            if (value >= 0)
+                return value;
+            nvm::virtual_sleep_for(seconds(5));
+        }
+        return -1;
+    }
+
+    TEST(mockTests, TestVirtualTimeSkipsMockedLatency)
+    {
+        using namespace ::testing;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        nvm::virtual_time vt;
+        NVM_FUNCTION_MOCK(now, NowSeconds, []() { return std::chrono::duration_cast<seconds>(nvm::virtual_clock::now().time_since_epoch()).count(); });
+
+        MockBackend m;
+        EXPECT_CALL(m, Fetch(_)).WillRepeatedly(Invoke([](int) { nvm::virtual_sleep_for(seconds(25)); return -1; }));
+        EXPECT_EQ(-1, FetchWithRetry(m, 1, 600));
+        EXPECT_GE(vt.now().time_since_epoch(), minutes(10));
+        EXPECT_LT(std::chrono::steady_clock::now() - start, seconds(5));
+
+        vt.advance(minutes(1));
+        EXPECT_GE(vt.now().time_since_epoch(), minutes(11));
+    }
+
+    TEST(mockTests, TestVirtualTimeWakesSleepersInDeadlineOrder)
+    {
+        nvm::virtual_time vt;
+        std::vector<int> order;
+        std::mutex orderMutex;
+        std::vector<std::thread> threads;
+        std::atomic<int> joined(0);
+        {
+            //! Hold time until every worker has joined, or the first to sleep would be woken alone.
+            nvm::virtual_time::participant starting(vt);
+            for (int i = 4; i > 0; --i)
+            {
+                threads.push_back(std::thread([&, i]()
+                {
+                    nvm::virtual_time::participant p(vt);
+                    ++joined;
+                    nvm::virtual_sleep_for(seconds(i * 10));
+                    std::lock_guard<std::mutex> lk(orderMutex);
+                    order.push_back(i);
+                }));
+            }
+            while (joined != 4)
+                std::this_thread::yield();
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+
+        ASSERT_EQ(4u, order.size());
+        for (int i = 0; i < 4; ++i)
+            EXPECT_EQ(i + 1, order[i]);
+        EXPECT_EQ(seconds(40), vt.now().time_since_epoch());
+    }
+
+    TEST(mockTests, TestVirtualTimeWaitsForRunningParticipants)
+    {
+        nvm::virtual_time vt;
+        std::atomic<bool> isWorking(true);
+        std::atomic<bool> isJoined(false);
+        std::thread worker([&]()
+        {
+            nvm::virtual_time::participant p(vt);
+            isJoined = true;
+            while (isWorking)
+                std::this_thread::yield();
+        });
+        while (!isJoined)
+            std::this_thread::yield();
+
+        std::thread sleeper([]() { nvm::virtual_sleep_for(seconds(1)); });
+        std::this_thread::sleep_for(milliseconds(20));
+        EXPECT_EQ(seconds(0), vt.now().time_since_epoch());
+
+        isWorking = false;
+        worker.join();
+        sleeper.join();
+        EXPECT_EQ(seconds(1), vt.now().time_since_epoch());
+    }
+
+    TEST(mockTests, TestVirtualTimeWaitsForWokenParticipants)
+    {
+        //! Participants woken together must all see the time they were woken at, however late one of them
+        //! runs, rather than a later time reached once the others went back to sleep.
+        nvm::virtual_time vt;
+        const int rounds = 200;
+        std::atomic<int> joined(0);
+        std::atomic<int> lateWakes(0);
+        std::vector<std::thread> threads;
+        {
+            nvm::virtual_time::participant starting(vt);
+            for (int i = 0; i < 2; ++i)
+            {
+                threads.push_back(std::thread([&]()
+                {
+                    nvm::virtual_time::participant p(vt);
+                    ++joined;
+                    for (int round = 1; round <= rounds; ++round)
+                    {
+                        nvm::virtual_sleep_for(seconds(10));
+                        if (nvm::virtual_clock::now().time_since_epoch() != seconds(10 * round))
+                            ++lateWakes;
+                    }
+                }));
+            }
+            while (joined != 2)
+                std::this_thread::yield();
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+
+        EXPECT_EQ(0, lateWakes);
+        EXPECT_EQ(seconds(10 * rounds), vt.now().time_since_epoch());
+    }
+
+    TEST(mockTests, TestFaultDelaysUseVirtualTime)
+    {
+        Backend b;
+        std::istringstream rules("Backend::Fetch delay=30s");
+        nvm::load_fault_rules(rules);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        {
+            nvm::virtual_time vt;
+            EXPECT_EQ(3, b.Fetch(3));
+            EXPECT_EQ(seconds(30), vt.now().time_since_epoch());
+        }
+        nvm::clear_fault_rules();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, seconds(5));
+        EXPECT_FALSE(nvm::virtual_time_active());
+    }
+
+}//! anonymous
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+//
+//! Copyright © 2015
+//! Brandon Kohn
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NVM_VIRTUALTIME_HPP
+#define NVM_VIRTUALTIME_HPP
+#pragma once
+
+//! Virtual time for mocks which simulate slow dependencies.
+//! While a virtual_time is alive, virtual_sleep_for and the delays of fault rules (see fault_injection.hpp) wait
+//! on a virtual clock rather than the system clock. When every thread taking part is asleep the clock jumps to
+//! the earliest deadline, so a test which simulates minutes of timeouts runs in as long as its real work takes.
+//! Mocked clocks report virtual_clock::now(); for example, with Clock::Now intercepted by NVM_FUNCTION_INTERCEPT:
+//! \code
+//! nvm::virtual_time vt;
+//! NVM_FUNCTION_MOCK(now, Clock::Now, []() { return nvm::virtual_clock::now(); });
+//! EXPECT_CALL(backend, Fetch(_)).WillOnce(Invoke([](int) { nvm::virtual_sleep_for(std::chrono::seconds(30)); return 0; }));
+//! \endcode
+#include "detail/thread/virtual_scheduler.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+#include <chrono>
+
+namespace nvm
+{
+    //! \struct virtual_clock
+    //! \brief A steady clock which reads the virtual time while a virtual_time is alive and the steady clock otherwise.
+    struct virtual_clock
+    {
+        typedef std::chrono::nanoseconds                    duration;
+        typedef duration::rep                               rep;
+        typedef duration::period                            period;
+        typedef std::chrono::time_point<virtual_clock>      time_point;
+        static const bool is_steady = true;
+
+        static time_point now()
+        {
+            if (detail::virtual_scheduler* pScheduler = detail::active_scheduler().load(std::memory_order_acquire))
+                return time_point(pScheduler->now());
+            return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()));
+        }
+    };
+
+    //! \brief Returns true while a virtual_time is alive.
+    inline bool virtual_time_active()
+    {
+        return detail::active_scheduler().load(std::memory_order_acquire) != 0;
+    }
+
+    //! \brief Sleeps for d of virtual time while a virtual_time is alive and for d of real time otherwise.
+    template <typename Rep, typename Period>
+    inline void virtual_sleep_for(const std::chrono::duration<Rep, Period>& d)
+    {
+        detail::sleep_for(std::chrono::duration_cast<std::chrono::nanoseconds>(d));
+    }
+
+    //! \brief Sleeps until the virtual_clock reads t.
+    inline void virtual_sleep_until(virtual_clock::time_point t)
+    {
+        virtual_sleep_for(t - virtual_clock::now());
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    //
+    //! \class virtual_time
+    //! \brief Puts the process on virtual time for the lifetime of the object. Virtual time starts at zero.
+    //! One virtual_time may be alive at a time and no thread may be sleeping in it when it is destroyed.
+    class virtual_time : boost::noncopyable
+    {
+    public:
+
+        //! \class participant
+        //! \brief Joins the calling thread for its lifetime: virtual time does not jump while the thread runs,
+        //! only while it sleeps. Use it for worker threads whose work between sleeps must not be overtaken.
+        //! A thread which starts workers can hold time with a participant of its own until they have joined.
+        class participant : boost::noncopyable
+        {
+        public:
+
+            explicit participant(virtual_time& vt)
+                : m_scheduler(vt.m_scheduler)
+            {
+                m_scheduler.join();
+            }
+
+            ~participant()
+            {
+                m_scheduler.leave();
+            }
+
+        private:
+
+            detail::virtual_scheduler& m_scheduler;
+        };
+
+        virtual_time()
+        {
+            detail::virtual_scheduler* pExpected = 0;
+            bool isInstalled = detail::active_scheduler().compare_exchange_strong(pExpected, &m_scheduler);
+            BOOST_ASSERT_MSG(isInstalled, "only one nvm::virtual_time may be alive at a time");
+            (void)isInstalled;
+        }
+
+        ~virtual_time()
+        {
+            detail::active_scheduler().store(0, std::memory_order_release);
+        }
+
+        virtual_clock::time_point now() const
+        {
+            return virtual_clock::time_point(m_scheduler.now());
+        }
+
+        //! \brief Moves virtual time forward by d, waking the threads whose deadlines pass.
+        template <typename Rep, typename Period>
+        void advance(const std::chrono::duration<Rep, Period>& d)
+        {
+            m_scheduler.advance(std::chrono::duration_cast<std::chrono::nanoseconds>(d));
+        }
+
+    private:
+
+        detail::virtual_scheduler m_scheduler;
+    };
+
+}//! namespace nvm;
+
+#endif // NVM_VIRTUALTIME_HPP